@@ -5,6 +5,8 @@
 
 #include <cstdio>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 const int kNumPrograms = 1;
 
@@ -17,43 +19,71 @@ enum EParams
 	k_threshold_dB = 4,
 	k_gain_dB = 5,
 	k_ratio = 6,
+	k_link = 7,
+	k_limiter_mode = 8,
+	k_lookahead_ms = 9,
+	k_key_source = 10,
+	k_key_filter = 11,
+	k_key_freq_Hz = 12,
+	k_bands = 13,
+	k_crossover1_Hz = 14,	// k_crossover1_Hz + i is the crossover between bands i and i + 1
+	k_oversampling = k_crossover1_Hz + kNumCrossovers,
+	k_knee_dB,
 	kNumParams
 };
 
 enum ELayout
 {
-	kWidth = GUI_WIDTH,
-	kHeight = GUI_HEIGHT,
+	kWidth = GUI_WIDTH * GUI_SCALE,
+	kHeight = GUI_HEIGHT * GUI_SCALE,
 
-	kGainX = 15,
-	kGainY = 20,
+	kGainX = 15 * GUI_SCALE,
+	kGainY = 20 * GUI_SCALE,
 
-	k_attack_msX = 80,
-	k_attack_msY = 20,
+	k_rms_period_msX = 15 * GUI_SCALE,
+	k_rms_period_msY = 90 * GUI_SCALE,
 
-	k_release_msX = 140,
-	k_release_msY = 20,
+	k_attack_msX = 80 * GUI_SCALE,
+	k_attack_msY = 20 * GUI_SCALE,
 
-	k_threshold_dBX = 80,
-	k_threshold_dBY = 90,
+	k_release_msX = 140 * GUI_SCALE,
+	k_release_msY = 20 * GUI_SCALE,
 
-	k_gain_dBX = 140,
-	k_gain_dBY = 90,
+	k_threshold_dBX = 80 * GUI_SCALE,
+	k_threshold_dBY = 90 * GUI_SCALE,
 
-	k_ratioX = 200,
-	k_ratioY = 20,
+	k_gain_dBX = 140 * GUI_SCALE,
+	k_gain_dBY = 90 * GUI_SCALE,
+
+	k_ratioX = 200 * GUI_SCALE,
+	k_ratioY = 20 * GUI_SCALE,
+
+	kMeterL = 200 * GUI_SCALE,
+	kMeterT = 142 * GUI_SCALE,
+	kMeterR = 318 * GUI_SCALE,
+	kMeterB = 166 * GUI_SCALE,
 
 	kKnobFrames = 128,
 };
 
 AudioCompressor::AudioCompressor(IPlugInstanceInfo instanceInfo)
-	: IPLUG_CTOR(kNumParams, kNumPrograms, instanceInfo), mGain(1.), comp(40.)
-
+	: IPLUG_CTOR(kNumParams, kNumPrograms, instanceInfo), requestedLatency(0), envelopeReservePending(false),
+	// parameter defaults, so that the audio thread sees them before OnParamChange() runs
+	mGain(0.5f), rms_period_ms(10.f), attack_ms(15.f), release_ms(60.f), threshold_dB(-20.f), gain_dB(0.f),
+	ratio(3.f), knee_dB(0.f), link(dsp::link_none), limiter_mode(kLimiterSoftClip), lookahead_ms(1.5f),
+	key_source(kKeyInternal), key_filter_type(kKeyFilterOff), key_freq_Hz(100.f), bands(1),
+	oversampling(kOversamplingOff)
 {
+	for (int i = 0; i < kNumCrossovers; ++i)
+		crossover_Hz[i].store(static_cast<float>(kDefaultCrossoverHz[i]));
+
 	//arguments are: name, defaultVal, minVal, maxVal, step, label
 	GetParam(kGain)->InitDouble("Preamp", 50., 0., 100.0, 0.01, "%");
 	GetParam(kGain)->SetShape(2.);
 
+	GetParam(k_rms_period_ms)->InitDouble("RMS period", 10., 0.1, kMaxRmsPeriodMs, 0.01, "ms");
+	GetParam(k_rms_period_ms)->SetShape(2.);
+
 	GetParam(k_attack_ms)->InitDouble("Attack", 15., 0., 100.0, 0.01, "ms");
 	GetParam(k_attack_ms)->SetShape(2.);
 
@@ -69,18 +99,74 @@ AudioCompressor::AudioCompressor(IPlugInstanceInfo instanceInfo)
 	GetParam(k_ratio)->InitDouble("Ratio", 3.0, 1.0, 100.0, 0.01, "");
 	GetParam(k_ratio)->SetShape(2.);
 
+	// 0 is a hard knee, the cheapest gain computer
+	GetParam(k_knee_dB)->InitDouble("Knee", 0., 0., 24., 0.01, "dB");
+
+	GetParam(k_link)->InitEnum("Stereo link", dsp::link_none, 3);
+	GetParam(k_link)->SetDisplayText(dsp::link_none, "Off");
+	GetParam(k_link)->SetDisplayText(dsp::link_max, "Max");
+	GetParam(k_link)->SetDisplayText(dsp::link_sum, "Sum");
+
+	// limiter mode and look-ahead change plugin latency, which is reported to the host from the GUI timer
+	// or host idle call after the audio thread applies them
+	GetParam(k_limiter_mode)->InitEnum("Limiter", kLimiterSoftClip, kNumLimiterModes);
+	GetParam(k_limiter_mode)->SetDisplayText(kLimiterSoftClip, "Soft clip");
+	GetParam(k_limiter_mode)->SetDisplayText(kLimiterLookahead, "Look-ahead");
+
+	GetParam(k_lookahead_ms)->InitDouble("Look-ahead", 1.5, 0., kMaxLookaheadMs, 0.01, "ms");
+
+	// external key is read from the sidechain inputs (kNumChannels..2*kNumChannels-1)
+	GetParam(k_key_source)->InitEnum("Key", kKeyInternal, kNumKeySources);
+	GetParam(k_key_source)->SetDisplayText(kKeyInternal, "Internal");
+	GetParam(k_key_source)->SetDisplayText(kKeyExternal, "Sidechain");
+
+	GetParam(k_key_filter)->InitEnum("Key filter", kKeyFilterOff, kNumKeyFilters);
+	GetParam(k_key_filter)->SetDisplayText(kKeyFilterOff, "Off");
+	GetParam(k_key_filter)->SetDisplayText(kKeyFilterHighPass, "High-pass");
+	GetParam(k_key_filter)->SetDisplayText(kKeyFilterBandPass, "Band-pass");
+
+	GetParam(k_key_freq_Hz)->InitDouble("Key freq", 100., 20., 10000., 1., "Hz");
+	GetParam(k_key_freq_Hz)->SetShape(3.);
+
+	// bands are compressed with the same settings; 1 band skips the crossover entirely
+	GetParam(k_bands)->InitInt("Bands", 1, 1, kNumCrossovers + 1);
+	for (int i = 0; i < kNumCrossovers; ++i)
+	{
+		char name[32];
+		sprintf(name, "Crossover %d", i + 1);
+		GetParam(k_crossover1_Hz + i)->InitDouble(name, kDefaultCrossoverHz[i], 20., 20000., 1., "Hz");
+		GetParam(k_crossover1_Hz + i)->SetShape(3.);
+	}
+
+	// compressor and soft clip run at the oversampled rate; the factor changes latency, which is reported
+	// to the host like for the limiter mode and look-ahead
+	GetParam(k_oversampling)->InitEnum("Oversampling", kOversamplingOff, kNumOversamplingModes);
+	GetParam(k_oversampling)->SetDisplayText(kOversamplingOff, "Off");
+	GetParam(k_oversampling)->SetDisplayText(kOversampling2x, "2x");
+	GetParam(k_oversampling)->SetDisplayText(kOversampling4x, "4x");
+	GetParam(k_oversampling)->SetDisplayText(kOversampling8x, "8x");
+
+	SetSingleReplacing(true);
+
 	IGraphics* pGraphics = MakeGraphics(this, kWidth, kHeight);
-	pGraphics->AttachBackground(BACKGROUND_ID, BACKGROUND_FN);
+	// at GUI_SCALE 1 LoadScaledIBitmap() returns the bitmaps as they are
+	IBitmap background = pGraphics->LoadScaledIBitmap(BACKGROUND_ID, BACKGROUND_FN, 1, GUI_SCALE);
+	pGraphics->AttachControl(new IBitmapControl(this, 0, 0, -1, &background, IChannelBlend::kBlendClobber));
+	// controls don't overlap, so only the damaged parts of the background need repainting when
+	// the meter or a knob changes
+	pGraphics->SetStrictDrawing(false);
 
-	IBitmap knob = pGraphics->LoadIBitmap(KNOB_ID, KNOB_FN, kKnobFrames);
-	IBitmap knob_large = pGraphics->LoadIBitmap(KNOB_ID2, KNOB_FN2, kKnobFrames);
+	IBitmap knob = pGraphics->LoadScaledIBitmap(KNOB_ID, KNOB_FN, kKnobFrames, GUI_SCALE);
+	IBitmap knob_large = pGraphics->LoadScaledIBitmap(KNOB_ID2, KNOB_FN2, kKnobFrames, GUI_SCALE);
 
 	pGraphics->AttachControl(new IKnobMultiControl(this, kGainX, kGainY, kGain, &knob));
+	pGraphics->AttachControl(new IKnobMultiControl(this, k_rms_period_msX, k_rms_period_msY, k_rms_period_ms, &knob));
 	pGraphics->AttachControl(new IKnobMultiControl(this, k_attack_msX, k_attack_msY, k_attack_ms, &knob));
 	pGraphics->AttachControl(new IKnobMultiControl(this, k_release_msX, k_release_msY, k_release_ms, &knob));
 	pGraphics->AttachControl(new IKnobMultiControl(this, k_threshold_dBX, k_threshold_dBY, k_threshold_dB, &knob));
 	pGraphics->AttachControl(new IKnobMultiControl(this, k_gain_dBX, k_gain_dBY, k_gain_dB, &knob));
 	pGraphics->AttachControl(new IKnobMultiControl(this, k_ratioX, k_ratioY, k_ratio, &knob_large));
+	pGraphics->AttachControl(new IMeterControl(this, IRECT(kMeterL, kMeterT, kMeterR, kMeterB), &meterQueue, kNumChannels));
 
 	AttachGraphics(pGraphics);
 
@@ -94,35 +180,150 @@ AudioCompressor::~AudioCompressor() {}
 void AudioCompressor::ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames)
 {
 
-	double* in1 = inputs[0];
-	double* in2 = inputs[1];
-	double* out1 = outputs[0];
-	double* out2 = outputs[1];
+	UpdateParams();
 
+	// the chain runs in single precision on chunks of the host buffer
+	float buffer[kNumChannels][kChunkSize];
+	float keyBuffer[kNumChannels][kChunkSize];
+	float* chunk[kNumChannels];
+	float* keyChunk[kNumChannels];
+	for (int c = 0; c < kNumChannels; ++c)
+	{
+		chunk[c] = buffer[c];
+		keyChunk[c] = keyBuffer[c];
+	}
+	const bool external = ExternalKey();
+	BeginMeterBlock(nFrames);
 
-	double sampleRate = this->GetSampleRate();
-	comp.set_attack(sampleRate*0.001*attack_ms.load());
-	comp.set_release(sampleRate*0.001*release_ms.load());
-	comp.set_threshold_dB(threshold_dB.load());
-	comp.set_gain_dB(gain_dB.load());
-	comp.set_ratio(ratio.load());
+	for (int offset = 0; offset < nFrames; offset += kChunkSize)
+	{
+		const int n = std::min(nFrames - offset, static_cast<int>(kChunkSize));
+		for (int c = 0; c < kNumChannels; ++c)
+			for (int s = 0; s < n; ++s)
+				chunk[c][s] = static_cast<float>(inputs[c][offset + s]);
 
+		if (external)
+			for (int c = 0; c < kNumChannels; ++c)
+				for (int s = 0; s < n; ++s)
+					keyChunk[c][s] = static_cast<float>(inputs[kNumChannels + c][offset + s]);
 
-	for (int s = 0; s < nFrames; ++s, ++in1, ++in2, ++out1, ++out2)
-	{
-		*out1 = *in1 * mGain;
-		*out2 = *in2 * mGain;
+		MeterChunk(chunk, n, engine.ProcessChunk(chunk, chunk, external ? keyChunk : NULL, n));
 
-		*out1 = lim(comp(*out1));
-		*out2 = lim(comp(*out2));
+		for (int c = 0; c < kNumChannels; ++c)
+			for (int s = 0; s < n; ++s)
+				outputs[c][offset + s] = chunk[c][s];
 	}
+	EndMeterBlock();
+}
 
+// 32 bit hosts: the chain runs directly on host buffers, without conversion to double and back.
+void AudioCompressor::ProcessSingleReplacing(float** inputs, float** outputs, int nFrames)
+{
+	UpdateParams();
+
+	const bool external = ExternalKey();
+	BeginMeterBlock(nFrames);
+	MeterChunk(outputs, nFrames, engine.Process(inputs, outputs, external ? inputs + kNumChannels : NULL, nFrames));
+	EndMeterBlock();
 }
 
+// Metering runs on the audio thread and only pushes to the lock-free meterQueue once per block; a reading
+// the GUI has no room for is dropped rather than waited for.
+void AudioCompressor::BeginMeterBlock(int nFrames)
+{
+	meterBlock.Clear(nFrames);
+}
 
-void AudioCompressor::Reset()
+// Accumulates output peak, sum of squares (in mRMS until EndMeterBlock()) and the largest gain reduction.
+void AudioCompressor::MeterChunk(const float* const* out, int n, float gainReduction)
 {
+	for (int c = 0; c < kNumChannels && c < METER_MAX_CHANNELS; ++c)
+	{
+		float peak = meterBlock.mPeak[c], sum = 0.f;
+		for (int s = 0; s < n; ++s)
+		{
+			peak = std::max(peak, std::abs(out[c][s]));
+			sum += out[c][s] * out[c][s];
+		}
+		meterBlock.mPeak[c] = peak;
+		meterBlock.mRMS[c] += sum;
+	}
+	meterBlock.mGainReduction = std::max(meterBlock.mGainReduction, gainReduction);
+}
+
+void AudioCompressor::EndMeterBlock()
+{
+	if (meterBlock.mNFrames <= 0)
+		return;
+	for (int c = 0; c < kNumChannels && c < METER_MAX_CHANNELS; ++c)
+		meterBlock.mRMS[c] = std::sqrt(meterBlock.mRMS[c] / meterBlock.mNFrames);
+	meterQueue.Push(meterBlock);
+}
 
+// Snapshot of the parameter values stored by OnParamChange().
+CompressorSettings AudioCompressor::CurrentSettings()
+{
+	CompressorSettings settings;
+	settings.preamp = mGain.load();
+	settings.rms_period_ms = rms_period_ms.load();
+	settings.attack_ms = attack_ms.load();
+	settings.release_ms = release_ms.load();
+	settings.threshold_dB = threshold_dB.load();
+	settings.gain_dB = gain_dB.load();
+	settings.ratio = ratio.load();
+	settings.knee_dB = knee_dB.load();
+	settings.link = link.load();
+	settings.limiter_mode = limiter_mode.load();
+	settings.lookahead_ms = lookahead_ms.load();
+	settings.key_filter = key_filter_type.load();
+	settings.key_freq_Hz = key_freq_Hz.load();
+	settings.bands = bands.load();
+	for (int i = 0; i < kNumCrossovers; ++i)
+		settings.crossover_Hz[i] = crossover_Hz[i].load();
+	settings.oversampling = oversampling.load();
+	return settings;
+}
+
+// Pass parameters which changed since the last call to the engine. Limiter mode, look-ahead and oversampling
+// take effect right away; the host has to be told about the new latency from its main thread, so it is only
+// requested here. Likewise a longer RMS period, more bands or a higher oversampling factor than the RMS
+// windows were allocated for is clamped until OnMainThreadIdle() grows them.
+void AudioCompressor::UpdateParams()
+{
+	engine.Update(CurrentSettings());
+	const int latency = engine.Latency();
+	if (latency != requestedLatency)
+		RequestLatency(requestedLatency = latency);
+	if (engine.EnvelopeReserveNeeded())
+		envelopeReservePending.store(true);
+}
+
+void AudioCompressor::OnMainThreadIdle()
+{
+	if (envelopeReservePending.exchange(false))
+	{
+		IMutexLock lock(this);
+		engine.ReserveEnvelope();
+	}
+}
+
+// Sidechain keys the detector only when selected and connected; otherwise the main input is used,
+// without any copies.
+bool AudioCompressor::ExternalKey()
+{
+	return (kKeyExternal == key_source.load() && IsInChannelConnected(kNumChannels));
+}
+
+void AudioCompressor::Reset()
+{
+	TRACE;
+	IMutexLock lock(this);
+
+	engine.Reset(GetSampleRate(), CurrentSettings());
+	int latency = engine.Latency();
+	RequestLatency(requestedLatency = latency);	// supersedes a latency the audio thread requested before
+	if (latency != GetLatency())
+		SetLatency(latency);
 }
 
 void AudioCompressor::OnParamChange(int paramIdx)
@@ -133,6 +334,10 @@ void AudioCompressor::OnParamChange(int paramIdx)
 		mGain.store(GetParam(kGain)->Value() / 100.);
 		break;
 
+	case k_rms_period_ms:
+		rms_period_ms.store(GetParam(k_rms_period_ms)->Value());
+		break;
+
 	case k_attack_ms:
 		attack_ms.store(GetParam(k_attack_ms)->Value());
 		break;
@@ -153,7 +358,45 @@ void AudioCompressor::OnParamChange(int paramIdx)
 		ratio.store(GetParam(k_ratio)->Value());
 		break;
 
+	case k_knee_dB:
+		knee_dB.store(GetParam(k_knee_dB)->Value());
+		break;
+
+	case k_link:
+		link.store(GetParam(k_link)->Int());
+		break;
+
+	case k_limiter_mode:
+		limiter_mode.store(GetParam(k_limiter_mode)->Int());
+		break;
+
+	case k_lookahead_ms:
+		lookahead_ms.store(GetParam(k_lookahead_ms)->Value());
+		break;
+
+	case k_key_source:
+		key_source.store(GetParam(k_key_source)->Int());
+		break;
+
+	case k_key_filter:
+		key_filter_type.store(GetParam(k_key_filter)->Int());
+		break;
+
+	case k_key_freq_Hz:
+		key_freq_Hz.store(GetParam(k_key_freq_Hz)->Value());
+		break;
+
+	case k_bands:
+		bands.store(GetParam(k_bands)->Int());
+		break;
+
+	case k_oversampling:
+		oversampling.store(GetParam(k_oversampling)->Int());
+		break;
+
 	default:
+		if (paramIdx >= k_crossover1_Hz && paramIdx < k_crossover1_Hz + kNumCrossovers)
+			crossover_Hz[paramIdx - k_crossover1_Hz].store(GetParam(paramIdx)->Value());
 		break;
 	}
 }
@@ -2,8 +2,9 @@
 #define __AUDIOCOMPRESSOR__
 
 #include "IPlug_include_in_plug_hdr.h"
+#include "IMeterQueue.h"
 #include <atomic>
-#include "dynamics.h"
+#include "AudioCompressorEngine.h"
 
 class AudioCompressor : public IPlug
 {
@@ -13,12 +14,26 @@ public:
 
 	void Reset();
 	void OnParamChange(int paramIdx);
+	void OnMainThreadIdle();
 	void ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames);
+	void ProcessSingleReplacing(float** inputs, float** outputs, int nFrames);
 
 
 private:
-	dsp::compressor<float> comp;
-	dsp::limiter<float> lim;
+	void UpdateParams();
+	CompressorSettings CurrentSettings();
+	bool ExternalKey();
+	void BeginMeterBlock(int nFrames);
+	void MeterChunk(const float* const* out, int n, float gainReduction);
+	void EndMeterBlock();
+
+	AudioCompressorEngine engine;
+	int requestedLatency;	// engine latency last passed to RequestLatency() or SetLatency()
+	std::atomic<bool> envelopeReservePending;	// set on the audio thread, the RMS windows are grown in OnMainThreadIdle()
+
+	// per-block output levels and gain reduction for the meter, accumulated over chunks on the audio thread
+	IMeterValues meterBlock;
+	IMeterQueue meterQueue;
 
 	std::atomic<float>  mGain;
 	std::atomic<float> rms_period_ms;
@@ -27,6 +42,16 @@ private:
 	std::atomic<float>  threshold_dB;
 	std::atomic<float>  gain_dB;
 	std::atomic<float>  ratio;
+	std::atomic<float>  knee_dB;
+	std::atomic<int>  link;
+	std::atomic<int>  limiter_mode;
+	std::atomic<float>  lookahead_ms;
+	std::atomic<int>  key_source;
+	std::atomic<int>  key_filter_type;
+	std::atomic<float>  key_freq_Hz;
+	std::atomic<int>  bands;
+	std::atomic<float>  crossover_Hz[dsp::multiband_compressor<float>::max_bands - 1];
+	std::atomic<int>  oversampling;
 };
 
 #endif
@@ -0,0 +1,257 @@
+#include "AudioCompressorEngine.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+const double kLimiterReleaseMs = 50.;
+const double kSmoothingMs = 20.;	// time constant of ramps following preamp, threshold, makeup gain and ratio changes
+
+CompressorSettings::CompressorSettings()
+	: preamp(0.5f), rms_period_ms(10.f), attack_ms(15.f), release_ms(60.f), threshold_dB(-20.f), gain_dB(0.f),
+	ratio(3.f), knee_dB(0.f), link(dsp::link_none), limiter_mode(kLimiterSoftClip), lookahead_ms(1.5f),
+	key_filter(kKeyFilterOff), key_freq_Hz(100.f), bands(1), oversampling(kOversamplingOff)
+{
+	for (int i = 0; i < kNumCrossovers; ++i)
+		crossover_Hz[i] = static_cast<float>(kDefaultCrossoverHz[i]);
+}
+
+AudioCompressorEngine::AudioCompressorEngine()
+	: comp(40, kNumChannels), lookahead_lim(kNumChannels), key_filter(2, kNumChannels),
+	oversampler(kNumChannels, kChunkSize), key_oversampler(kNumChannels, kChunkSize),
+	sampleRate(44100.), active_oversampling(1), envelope_period(40),
+	oversampled(2 * kNumChannels * kChunkSize * dsp::oversampler<float>::max_factor),
+	compression_dB(kChunkSize * dsp::oversampler<float>::max_factor)
+{
+	comp.set_accuracy(dsp::accuracy_0_01dB);
+}
+
+void AudioCompressorEngine::Reset(double sampleRate, const CompressorSettings& settings)
+{
+	this->sampleRate = sampleRate;
+
+	lookahead_lim.reserve(static_cast<size_t>(std::ceil(sampleRate*0.001*kMaxLookaheadMs)));
+	lookahead_lim.set_release(static_cast<float>(sampleRate*0.001*kLimiterReleaseMs));
+	lookahead_lim.set_ceiling(lim.threshold());
+
+	// sample rate may have changed, so derived coefficients are recomputed and ramps start settled
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	applied.rms_period_ms = applied.attack_ms = applied.release_ms = nan;
+	applied.threshold_dB = applied.gain_dB = applied.ratio = applied.knee_dB = nan;
+	applied.key_freq_Hz = applied.lookahead_ms = nan;
+	for (int i = 0; i < kNumCrossovers; ++i)
+		applied.crossover_Hz[i] = nan;
+	applied.link = applied.key_filter = applied.bands = applied.limiter_mode = applied.oversampling = -1;
+	preamp.set_time_constant(static_cast<float>(sampleRate*0.001*kSmoothingMs));
+	Update(settings);
+	ReserveEnvelope();
+	comp.settle();
+	preamp.settle();
+}
+
+bool AudioCompressorEngine::EnvelopeReserveNeeded() const
+{
+	return comp.envelope_reserve_needed(comp.bands(), envelope_period);
+}
+
+void AudioCompressorEngine::ReserveEnvelope()
+{
+	comp.reserve_envelope(comp.bands(), envelope_period);
+	comp.set_envelope_period(envelope_period);
+}
+
+int AudioCompressorEngine::Latency() const
+{
+	int latency = static_cast<int>(oversampler.latency());
+	if (kLimiterLookahead == applied.limiter_mode)
+		latency += static_cast<int>(lookahead_lim.latency());
+	return latency;
+}
+
+void AudioCompressorEngine::Update(const CompressorSettings& settings)
+{
+	// the oversampling factor changes the rate everything below runs at, so the settings derived from it
+	// are recomputed; set_factor() resets the half-band filters and doesn't allocate
+	if (settings.oversampling != applied.oversampling)
+	{
+		active_oversampling = 1 << (applied.oversampling = settings.oversampling);
+		oversampler.set_factor(active_oversampling);
+		key_oversampler.set_factor(active_oversampling);
+		comp.set_smoothing(static_cast<float>(ProcessRate()*0.001*kSmoothingMs));
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		applied.rms_period_ms = applied.attack_ms = applied.release_ms = nan;
+		for (int i = 0; i < kNumCrossovers; ++i)
+			applied.crossover_Hz[i] = nan;
+	}
+
+	const double rate = ProcessRate();
+	float value;
+	if ((value = settings.rms_period_ms) != applied.rms_period_ms)
+	{
+		envelope_period = static_cast<size_t>(rate*0.001*(applied.rms_period_ms = value) + 0.5);
+		comp.set_envelope_period(envelope_period);
+	}
+	if ((value = settings.attack_ms) != applied.attack_ms)
+		comp.set_attack(static_cast<float>(rate*0.001*(applied.attack_ms = value)));
+	if ((value = settings.release_ms) != applied.release_ms)
+		comp.set_release(static_cast<float>(rate*0.001*(applied.release_ms = value)));
+	if ((value = settings.threshold_dB) != applied.threshold_dB)
+		comp.set_threshold_dB(applied.threshold_dB = value);
+	if ((value = settings.gain_dB) != applied.gain_dB)
+		comp.set_gain_dB(applied.gain_dB = value);
+	if ((value = settings.ratio) != applied.ratio)
+		comp.set_ratio(applied.ratio = value);
+	if ((value = settings.knee_dB) != applied.knee_dB)
+		comp.set_knee_dB(applied.knee_dB = value);
+
+	if (settings.link != applied.link)
+		comp.set_link(static_cast<dsp::compressor_link>(applied.link = settings.link));
+
+	if (settings.bands != applied.bands)
+		comp.set_bands(applied.bands = settings.bands);
+	// the crossovers in use are applied in increasing order: one automated past its neighbour would
+	// otherwise give overlapping or empty bands; there are at most 4, so insertion sort (std::sort on the
+	// 4 element array trips a GCC -Warray-bounds false positive)
+	float crossover_Hz[kNumCrossovers];
+	std::copy(settings.crossover_Hz, settings.crossover_Hz + kNumCrossovers, crossover_Hz);
+	const int used = std::max(0, std::min(settings.bands - 1, kNumCrossovers));
+	for (int i = 1; i < used; ++i)
+		for (int j = i; j > 0 && crossover_Hz[j] < crossover_Hz[j - 1]; --j)
+			std::swap(crossover_Hz[j], crossover_Hz[j - 1]);
+	for (int i = 0; i < kNumCrossovers; ++i)
+		if ((value = crossover_Hz[i]) != applied.crossover_Hz[i])
+			comp.set_crossover(i, (applied.crossover_Hz[i] = value) / rate);
+
+	if (settings.key_filter != applied.key_filter || settings.key_freq_Hz != applied.key_freq_Hz)
+	{
+		if (settings.key_filter != applied.key_filter)
+			key_filter.reset();
+		applied.key_filter = settings.key_filter;
+		applied.key_freq_Hz = settings.key_freq_Hz;
+		DesignKeyFilter();
+	}
+
+	// limiter mode and look-ahead change Latency(), which the caller reports to the host; the look-ahead
+	// limiter is reset only when it is switched in or its delay changes by whole samples
+	if (settings.limiter_mode != applied.limiter_mode)
+	{
+		if (kLimiterLookahead == settings.limiter_mode)
+			lookahead_lim.reset();
+		applied.limiter_mode = settings.limiter_mode;
+	}
+	if ((value = settings.lookahead_ms) != applied.lookahead_ms)
+	{
+		const size_t lookahead = static_cast<size_t>(sampleRate*0.001*(applied.lookahead_ms = value) + 0.5);
+		if (lookahead != lookahead_lim.lookahead())
+			lookahead_lim.set_lookahead(lookahead);
+	}
+
+	preamp.set_target(settings.preamp);
+}
+
+// 4th order Butterworth high-pass, or band-pass made of 2nd order high-pass an octave below
+// and low-pass an octave above the key frequency.
+void AudioCompressorEngine::DesignKeyFilter()
+{
+	const double f = applied.key_freq_Hz / sampleRate;
+	if (kKeyFilterBandPass == applied.key_filter)
+	{
+		key_filter.set_section(0, dsp::design_biquad<float>(dsp::biquad_highpass, f * 0.5));
+		key_filter.set_section(1, dsp::design_biquad<float>(dsp::biquad_lowpass, f * 2.));
+	}
+	else
+	{
+		key_filter.set_section(0, dsp::design_biquad<float>(dsp::biquad_highpass, f, 0.54119610));
+		key_filter.set_section(1, dsp::design_biquad<float>(dsp::biquad_highpass, f, 1.30656296));
+	}
+}
+
+float AudioCompressorEngine::ProcessChunk(const float* const* in, float* const* out, const float* const* key, int n)
+{
+	float gain[kChunkSize];
+	preamp.fill(gain, n);
+	for (int c = 0; c < kNumChannels; ++c)
+		for (int s = 0; s < n; ++s)
+			out[c][s] = in[c][s] * gain[s];
+
+	if (NULL == key)
+		key = out;
+
+	float buffer[kNumChannels][kChunkSize];
+	float* filtered[kNumChannels];
+	if (kKeyFilterOff != applied.key_filter)
+	{
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			filtered[c] = buffer[c];
+			key_filter.process(key[c], filtered[c], n, c);
+		}
+		key = filtered;
+	}
+
+	float* gr = &compression_dB[0];
+	const int m = n * active_oversampling;
+	if (1 == active_oversampling)
+	{
+		comp.process(out, out, key, n, gr);
+		if (kLimiterLookahead != applied.limiter_mode)
+			for (int c = 0; c < kNumChannels; ++c)
+				lim.process(out[c], out[c], n);
+	}
+	else
+	{
+		// the key is oversampled too, unless the signal keys the detector itself: then up is passed as
+		// the key, so that the compressor sees it is self-keyed and splits the bands only once
+		const int stride = kChunkSize * dsp::oversampler<float>::max_factor;
+		const bool selfKeyed = (key == out);
+		float* up[kNumChannels];
+		float* upKey[kNumChannels];
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			up[c] = &oversampled[c * stride];
+			oversampler.upsample(out[c], up[c], n, c);
+			if (!selfKeyed)
+			{
+				upKey[c] = &oversampled[(kNumChannels + c) * stride];
+				key_oversampler.upsample(key[c], upKey[c], n, c);
+			}
+		}
+		comp.process(up, up, selfKeyed ? up : upKey, m, gr);
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			if (kLimiterLookahead != applied.limiter_mode)
+				lim.process(up[c], up[c], m);
+			oversampler.downsample(up[c], out[c], n, c);
+		}
+	}
+
+	// look-ahead limiter detects true peaks on its own, so it stays at the base rate
+	if (kLimiterLookahead == applied.limiter_mode)
+		lookahead_lim.process(out, out, n);
+
+	float g = 0.f;
+	for (int s = 0; s < m; ++s)
+		g = std::min(g, gr[s]);
+	return -g;
+}
+
+float AudioCompressorEngine::Process(const float* const* in, float* const* out, const float* const* key, int nFrames)
+{
+	const float* chunkIn[kNumChannels];
+	const float* chunkKey[kNumChannels];
+	float* chunkOut[kNumChannels];
+	float reduction = 0.f;
+	for (int offset = 0; offset < nFrames; offset += kChunkSize)
+	{
+		const int n = std::min(nFrames - offset, static_cast<int>(kChunkSize));
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			chunkIn[c] = in[c] + offset;
+			chunkOut[c] = out[c] + offset;
+			if (NULL != key)
+				chunkKey[c] = key[c] + offset;
+		}
+		reduction = std::max(reduction, ProcessChunk(chunkIn, chunkOut, NULL != key ? chunkKey : NULL, n));
+	}
+	return reduction;
+}
@@ -0,0 +1,125 @@
+#ifndef __AUDIOCOMPRESSORENGINE__
+#define __AUDIOCOMPRESSORENGINE__
+
+#include "dynamics.h"
+#include "multiband.h"
+#include "lookahead.h"
+#include "biquad.h"
+#include "oversampling.h"
+#include "smoothing.h"
+#include <vector>
+
+const int kNumChannels = 2;
+const int kChunkSize = 256;
+const int kNumCrossovers = dsp::multiband_compressor<float>::max_bands - 1;
+const double kDefaultCrossoverHz[kNumCrossovers] = {120., 800., 3000., 8000.};
+const double kMaxRmsPeriodMs = 300.;
+const double kMaxLookaheadMs = 10.;
+
+enum EKeySource
+{
+	kKeyInternal = 0,
+	kKeyExternal = 1,
+	kNumKeySources
+};
+
+enum EKeyFilter
+{
+	kKeyFilterOff = 0,
+	kKeyFilterHighPass = 1,
+	kKeyFilterBandPass = 2,
+	kNumKeyFilters
+};
+
+// oversampling factor is 1 << EOversampling
+enum EOversampling
+{
+	kOversamplingOff = 0,
+	kOversampling2x = 1,
+	kOversampling4x = 2,
+	kOversampling8x = 3,
+	kNumOversamplingModes
+};
+
+enum ELimiterMode
+{
+	kLimiterSoftClip = 0,
+	kLimiterLookahead = 1,
+	kNumLimiterModes
+};
+
+// Settings of the processing chain in parameter units; the defaults match the plugin parameter defaults.
+struct CompressorSettings
+{
+	CompressorSettings();
+
+	float preamp;		// linear gain
+	float rms_period_ms, attack_ms, release_ms, threshold_dB, gain_dB, ratio;
+	float knee_dB;		// soft knee width, 0 is hard knee
+	int link;			// dsp::compressor_link
+	int limiter_mode;	// ELimiterMode
+	float lookahead_ms;
+	int key_filter;		// EKeyFilter
+	float key_freq_Hz;
+	int bands;
+	float crossover_Hz[kNumCrossovers];
+	int oversampling;	// EOversampling
+};
+
+// Preamp, multiband compressor and limiter chain on kNumChannels channels, independent of the plugin API,
+// so that the plugin and the offline renderer run exactly the same processing. Not copyable, owns the
+// multiband compressor.
+class AudioCompressorEngine
+{
+public:
+	AudioCompressorEngine();
+
+	// Preallocates for sampleRate and applies all settings; allocates, so not for the audio thread.
+	void Reset(double sampleRate, const CompressorSettings& settings);
+
+	// The RMS windows are allocated for the active bands and the current period only. When Update() sets
+	// a longer period or more bands, the period is clamped to the allocated length until ReserveEnvelope()
+	// grows the windows, which allocates, so the audio thread only checks EnvelopeReserveNeeded().
+	bool EnvelopeReserveNeeded() const;
+	void ReserveEnvelope();
+
+	// Passes settings which changed since the last call to the DSP objects; the smoothed ones only get new
+	// ramp targets. Never allocates; limiter mode, look-ahead and oversampling change Latency() right away,
+	// a higher oversampling factor may need ReserveEnvelope() for the longer RMS window.
+	void Update(const CompressorSettings& settings);
+
+	int Latency() const;
+	double SampleRate() const { return sampleRate; }
+
+	// Processes up to kChunkSize samples; out may point to the same buffers as in. The detector is keyed by
+	// the (preamplified) signal itself when key is NULL. Returns the largest gain reduction in dB (>= 0).
+	float ProcessChunk(const float* const* in, float* const* out, const float* const* key, int n);
+
+	// Processes any number of samples in chunks, returns the largest gain reduction in dB.
+	float Process(const float* const* in, float* const* out, const float* const* key, int nFrames);
+
+private:
+	AudioCompressorEngine(const AudioCompressorEngine&);
+	AudioCompressorEngine& operator=(const AudioCompressorEngine&);
+
+	void DesignKeyFilter();
+	double ProcessRate() const { return sampleRate * active_oversampling; }
+
+	dsp::multiband_compressor<float> comp;
+	dsp::limiter<float, dsp::fast_tanh<float> > lim;
+	dsp::lookahead_limiter<float> lookahead_lim;
+	dsp::smoothed_value<float> preamp;
+	dsp::biquad_cascade<float> key_filter;
+	dsp::oversampler<float> oversampler;
+	dsp::oversampler<float> key_oversampler;
+	double sampleRate;
+	int active_oversampling;	// oversampling factor, 1 << applied.oversampling
+	size_t envelope_period;		// RMS window in samples at ProcessRate(), may exceed the allocated length
+	std::vector<float> oversampled;		// kNumChannels oversampled chunks of the signal and of the key
+	std::vector<float> compression_dB;	// gain reduction of an oversampled chunk
+
+	// settings last passed to the DSP objects, so that derived coefficients are recomputed only on change
+	CompressorSettings applied;
+};
+
+#endif
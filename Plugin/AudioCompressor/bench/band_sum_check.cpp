@@ -0,0 +1,172 @@
+/*
+ * Regression check for the multiband crossover.
+ *
+ * With the compressor at ratio 1 the chain is linear (the limiter stays below its threshold), so its
+ * impulse response must be the allpass response of the Linkwitz-Riley bands summed back, flat in
+ * magnitude. Checked for 2-5 bands with crossovers in order and out of order, as when one crossover
+ * parameter is automated past its neighbour. The chain runs in float, whose rounding in the low crossover
+ * sections leaves about 0.004-0.005 dB at 20 Hz (the same crossover in double is flat to about 1e-11 dB),
+ * hence the 0.01 dB default limit.
+ *
+ * The band sum is an allpass whatever the order, but out of order crossovers give overlapping or empty
+ * bands, so each band compressor would see the wrong part of the spectrum. The engine applies the
+ * crossovers sorted, so a compressed render with crossovers out of order must be identical to the one
+ * with the same frequencies in order.
+ *
+ * Build and run from Plugin/AudioCompressor/bench:
+ *   make
+ *   ./band_sum_check [max_deviation_dB]
+ * Exits with status 1 if the magnitude deviates from flat by more than max_deviation_dB (default 0.01)
+ * at any of the tested frequencies, or if the order of the crossovers changes the output.
+ */
+#include "AudioCompressorEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const double kSampleRate = 48000.;
+const int kLength = 1 << 15;
+const double kImpulse = 0.5;
+
+struct Config
+{
+	const char* name;
+	int bands;
+	float crossover_Hz[kNumCrossovers];
+};
+
+CompressorSettings make_settings(const Config& config, bool sorted)
+{
+	CompressorSettings settings;
+	settings.preamp = 1.f;
+	settings.bands = config.bands;
+	for (int i = 0; i < kNumCrossovers; ++i)
+		settings.crossover_Hz[i] = config.crossover_Hz[i];
+	if (sorted)
+		std::sort(settings.crossover_Hz, settings.crossover_Hz + config.bands - 1);
+	return settings;
+}
+
+// Runs the chain over the same input on all channels and returns the output of the first one.
+std::vector<float> render(const CompressorSettings& settings, const std::vector<float>& input, int* latency)
+{
+	AudioCompressorEngine engine;
+	engine.Reset(kSampleRate, settings);
+	*latency = engine.Latency();
+
+	const int n = static_cast<int>(input.size());
+	std::vector<float> out[kNumChannels];
+	const float* pin[kNumChannels];
+	float* pout[kNumChannels];
+	for (int c = 0; c < kNumChannels; ++c)
+	{
+		out[c].resize(n);
+		pin[c] = &input[0];
+		pout[c] = &out[c][0];
+	}
+	engine.Process(pin, pout, NULL, n);
+	return out[0];
+}
+
+// Largest deviation from 0 dB of the magnitude response of the chain, at 1/6 octave steps from 20 Hz.
+double flatness(const Config& config)
+{
+	CompressorSettings settings = make_settings(config, false);
+	settings.ratio = 1.f;
+
+	std::vector<float> impulse(kLength, 0.f);
+	impulse[0] = static_cast<float>(kImpulse);
+	int latency;
+	const std::vector<float> out = render(settings, impulse, &latency);
+
+	const double pi = 3.14159265358979323846;
+	double worst = 0., worstHz = 0.;
+	for (double f = 20.; f < 20000.; f *= std::pow(2., 1. / 6.))
+	{
+		double re = 0., im = 0.;
+		for (int s = latency; s < kLength; ++s)
+		{
+			const double w = 2. * pi * f * (s - latency) / kSampleRate;
+			re += out[s] * std::cos(w);
+			im -= out[s] * std::sin(w);
+		}
+		const double dB = std::fabs(20. * std::log10(std::sqrt(re * re + im * im) / kImpulse));
+		if (dB > worst)
+		{
+			worst = dB;
+			worstHz = f;
+		}
+	}
+	printf("%-28s %d  %9.5f dB (at %.0f Hz)", config.name, config.bands, worst, worstHz);
+	return worst;
+}
+
+// Largest difference between compressed renders of noise with the crossovers as given and sorted.
+double order_difference(const Config& config)
+{
+	std::vector<float> noise(kLength);
+	srand(1);
+	for (int s = 0; s < kLength; ++s)
+		noise[s] = static_cast<float>(0.5 * (rand() / static_cast<double>(RAND_MAX) - 0.5));
+
+	CompressorSettings settings = make_settings(config, false);
+	settings.threshold_dB = -30.f;
+	settings.ratio = 4.f;
+	int latency;
+	const std::vector<float> given = render(settings, noise, &latency);
+	settings = make_settings(config, true);
+	settings.threshold_dB = -30.f;
+	settings.ratio = 4.f;
+	const std::vector<float> sorted = render(settings, noise, &latency);
+
+	double worst = 0.;
+	for (int s = 0; s < kLength; ++s)
+		worst = std::max(worst, static_cast<double>(std::fabs(given[s] - sorted[s])));
+	printf("  %9.2g\n", worst);
+	return worst;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const double maxDeviation = (argc > 1 ? atof(argv[1]) : 0.01);
+	if (maxDeviation <= 0.)
+	{
+		fprintf(stderr, "usage: band_sum_check [max_deviation_dB > 0]\n");
+		return 1;
+	}
+
+	const Config configs[] = {
+		{"in order", 2, {1000.f, 3000.f, 8000.f, 12000.f}},
+		{"in order", 3, {120.f, 800.f, 3000.f, 8000.f}},
+		{"in order", 5, {120.f, 800.f, 3000.f, 8000.f}},
+		{"2nd crossover below 1st", 3, {2000.f, 200.f, 3000.f, 8000.f}},
+		{"3rd crossover below 1st", 4, {500.f, 2000.f, 100.f, 8000.f}},
+		{"reversed", 5, {8000.f, 3000.f, 800.f, 120.f}},
+		{"equal crossovers", 4, {1000.f, 1000.f, 4000.f, 8000.f}},
+	};
+
+	printf("%-28s %s  %-30s %s\n", "crossovers", "bands", "deviation from flat", "difference from sorted");
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i)
+	{
+		const bool flat = (flatness(configs[i]) <= maxDeviation);
+		const bool same = (0. == order_difference(configs[i]));
+		if (!flat || !same)
+			++failed;
+	}
+
+	if (failed > 0)
+	{
+		printf("FAILED: %d configuration(s) not flat within %g dB or depending on the crossover order\n", failed, maxDeviation);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,388 @@
+/*
+ * Microbenchmarks of the dsp++ building blocks and of the whole processing chain, in nanoseconds per
+ * sample (one sample of one channel), written as JSON so that runs can be compared for regressions.
+ *
+ * Kernels:
+ *   compressor            dsp::compressor<T> (RMS detector), channels unlinked, 0.01 dB accuracy
+ *   compressor_soft_knee  the same with 6 dB soft knee
+ *   compressor_peak       the same with hard knee and peak_follower detector
+ *   limiter               dsp::limiter<T, fast_tanh<T> >, one per channel
+ *   arithmetic_mean, geometric_mean, harmonic_mean, quadratic_mean
+ *                         the generalized_mean specializations, process_frame() over all channels
+ *   generalized_mean      generalized_mean<T, T> with the generic power functor, p = 3
+ *   fixed_order_mean      fixed_order_mean<T, 3>, the same mean with the order known at compile time
+ *   process_double        AudioCompressor::ProcessDoubleReplacing(): double host buffers converted to
+ *                         float chunks around AudioCompressorEngine::ProcessChunk(), default settings
+ *   process_single        AudioCompressor::ProcessSingleReplacing(): AudioCompressorEngine::Process()
+ *
+ * each at block sizes 16 to 4096, float and double, 1 to 8 channels; the plugin paths are stereo and
+ * run the chain in single precision, so they're reported only for their own precision and 2 channels.
+ *
+ * Build and run from Plugin/AudioCompressor/bench:
+ *   make
+ *   ./dsp_bench [-o results.json] [-t min_ms] [-r repeats] [kernel...]
+ * Without -o the JSON goes to stdout; with it a table is printed instead. Timings are the best of the
+ * repeats, each running the kernel for at least min_ms milliseconds.
+ */
+#include "AudioCompressorEngine.h"
+#include "dynamics.h"
+#include "mean.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kSampleRate = 48000.;
+const int kMinBlock = 16;
+const int kMaxBlock = 4096;
+const int kMaxChannels = 8;
+
+struct Options
+{
+	Options(): output(NULL), min_ms(10.), repeats(3) {}
+
+	const char* output;
+	double min_ms;
+	int repeats;
+	std::vector<std::string> kernels;	// empty: all
+
+	bool selected(const char* kernel) const
+	{
+		if (kernels.empty())
+			return true;
+		for (size_t i = 0; i < kernels.size(); ++i)
+			if (kernels[i] == kernel)
+				return true;
+		return false;
+	}
+};
+
+struct Result
+{
+	const char* kernel;
+	const char* precision;
+	int channels;
+	int block;
+	double ns_per_sample;
+};
+
+double checksum = 0;	// printed, so that the optimizer can't drop the benchmarked code
+
+// Planar test signal: noise at about -12 dBFS with a slow level sweep, so that the compressor and the
+// limiter spend time both above and below threshold; strictly positive when the kernel needs it.
+template<class T>
+struct Signal
+{
+	Signal(int channels, int block, bool positive)
+	 :	data(channels * block)
+	 ,	in(channels)
+	 ,	out(channels)
+	 ,	result(channels * block)
+	{
+		srand(1);
+		for (int c = 0; c < channels; ++c)
+		{
+			for (int s = 0; s < block; ++s)
+			{
+				const double level = 0.25 + 1.5 * s / block;
+				const double noise = rand() / static_cast<double>(RAND_MAX) - 0.5;
+				data[c * block + s] = static_cast<T>(positive ? 0.01 + level * (noise + 0.5) : level * noise);
+			}
+			in[c] = &data[c * block];
+			out[c] = &result[c * block];
+		}
+	}
+
+	void accumulate()
+	{
+		for (size_t i = 0; i < result.size(); i += 61)
+			checksum += result[i];
+	}
+
+	std::vector<T> data;
+	std::vector<const T*> in;
+	std::vector<T*> out;
+	std::vector<T> result;
+};
+
+// Calls run() (which processes block frames) repeatedly for at least min_ms, returns the best of the
+// repeats in nanoseconds per sample.
+template<class Run>
+double measure(Run run, int channels, int block, const Options& opts)
+{
+	typedef std::chrono::steady_clock clock;
+	run();	// warm up caches and lazily initialized state
+	double best = 0;
+	for (int r = 0; r < opts.repeats; ++r)
+	{
+		long calls = 0;
+		const clock::time_point start = clock::now();
+		double ns;
+		do
+		{
+			for (int i = 0; i < 16; ++i)
+				run();
+			calls += 16;
+			ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		}
+		while (ns < opts.min_ms * 1e6);
+		const double per_sample = ns / (static_cast<double>(calls) * block * channels);
+		if (0 == r || per_sample < best)
+			best = per_sample;
+	}
+	return best;
+}
+
+template<class T> const char* precision_name();
+template<> const char* precision_name<float>() {return "float";}
+template<> const char* precision_name<double>() {return "double";}
+
+template<class T, class Envelope>
+void bench_compressor(const char* kernel, float knee_dB, int channels, int block, const Options& opts,
+	std::vector<Result>& results)
+{
+	dsp::compressor<T, Envelope> comp(static_cast<size_t>(kSampleRate * 0.01), channels);
+	comp.set_accuracy(dsp::accuracy_0_01dB);
+	comp.set_knee_dB(knee_dB);
+	comp.set_attack(static_cast<T>(kSampleRate * 0.015));
+	comp.set_release(static_cast<T>(kSampleRate * 0.06));
+	comp.set_threshold_dB(-20);
+	comp.set_ratio(3);
+	comp.settle();
+	Signal<T> sig(channels, block, false);
+	const Result r = {kernel, precision_name<T>(), channels, block,
+		measure([&]() {comp.process(&sig.in[0], &sig.out[0], block);}, channels, block, opts)};
+	results.push_back(r);
+	sig.accumulate();
+}
+
+template<class T>
+void bench_limiter(int channels, int block, const Options& opts, std::vector<Result>& results)
+{
+	std::vector<dsp::limiter<T, dsp::fast_tanh<T> > > lim(channels);
+	Signal<T> sig(channels, block, false);
+	const Result r = {"limiter", precision_name<T>(), channels, block,
+		measure([&]() {
+			for (int c = 0; c < channels; ++c)
+				lim[c].process(sig.in[c], sig.out[c], block);
+		}, channels, block, opts)};
+	results.push_back(r);
+	sig.accumulate();
+}
+
+// Means process interleaved frames, so the planar signal is transposed once up front.
+template<class Mean, class T>
+void bench_mean(const char* kernel, Mean& mean, int channels, int block, const Options& opts,
+	std::vector<Result>& results)
+{
+	Signal<T> sig(channels, block, true);
+	std::vector<T> frames(channels * block);
+	for (int c = 0; c < channels; ++c)
+		for (int s = 0; s < block; ++s)
+			frames[s * channels + c] = sig.in[c][s];
+	T* out = &sig.result[0];
+	const Result r = {kernel, precision_name<T>(), channels, block,
+		measure([&]() {
+			for (int s = 0; s < block; ++s)
+				mean.process_frame(&frames[s * channels], out + s * channels);
+		}, channels, block, opts)};
+	results.push_back(r);
+	sig.accumulate();
+}
+
+template<class T>
+void bench_means(int channels, int block, const Options& opts, std::vector<Result>& results)
+{
+	const size_t L = static_cast<size_t>(kSampleRate * 0.01);
+	if (opts.selected("arithmetic_mean"))
+	{
+		dsp::arithmetic_mean<T> mean(L, T(), channels);
+		bench_mean<dsp::arithmetic_mean<T>, T>("arithmetic_mean", mean, channels, block, opts, results);
+	}
+	if (opts.selected("geometric_mean"))
+	{
+		dsp::geometric_mean<T> mean(L, T(1), channels);
+		bench_mean<dsp::geometric_mean<T>, T>("geometric_mean", mean, channels, block, opts, results);
+	}
+	if (opts.selected("harmonic_mean"))
+	{
+		dsp::harmonic_mean<T> mean(L, T(1), channels);
+		bench_mean<dsp::harmonic_mean<T>, T>("harmonic_mean", mean, channels, block, opts, results);
+	}
+	if (opts.selected("quadratic_mean"))
+	{
+		dsp::quadratic_mean<T> mean(L, T(), channels);
+		bench_mean<dsp::quadratic_mean<T>, T>("quadratic_mean", mean, channels, block, opts, results);
+	}
+	if (opts.selected("generalized_mean"))
+	{
+		dsp::generalized_mean<T, T> mean(L, T(3), T(), channels);
+		bench_mean<dsp::generalized_mean<T, T>, T>("generalized_mean", mean, channels, block, opts, results);
+	}
+	if (opts.selected("fixed_order_mean"))
+	{
+		dsp::fixed_order_mean<T, 3> mean(L, T(), channels);
+		bench_mean<dsp::fixed_order_mean<T, 3>, T>("fixed_order_mean", mean, channels, block, opts, results);
+	}
+}
+
+template<class T>
+void bench_precision(const Options& opts, std::vector<Result>& results)
+{
+	for (int channels = 1; channels <= kMaxChannels; channels *= 2)
+		for (int block = kMinBlock; block <= kMaxBlock; block *= 2)
+		{
+			if (opts.selected("compressor"))
+				bench_compressor<T, dsp::quadratic_mean<T> >("compressor", 0.f, channels, block, opts, results);
+			if (opts.selected("compressor_soft_knee"))
+				bench_compressor<T, dsp::quadratic_mean<T> >("compressor_soft_knee", 6.f, channels, block, opts, results);
+			if (opts.selected("compressor_peak"))
+				bench_compressor<T, dsp::peak_follower<T> >("compressor_peak", 0.f, channels, block, opts, results);
+			if (opts.selected("limiter"))
+				bench_limiter<T>(channels, block, opts, results);
+			bench_means<T>(channels, block, opts, results);
+		}
+}
+
+// Same conversion loop as AudioCompressor::ProcessDoubleReplacing(), minus the metering.
+void process_double(AudioCompressorEngine& engine, double** inputs, double** outputs, int nFrames)
+{
+	float buffer[kNumChannels][kChunkSize];
+	float* chunk[kNumChannels];
+	for (int c = 0; c < kNumChannels; ++c)
+		chunk[c] = buffer[c];
+
+	for (int offset = 0; offset < nFrames; offset += kChunkSize)
+	{
+		const int n = std::min(nFrames - offset, static_cast<int>(kChunkSize));
+		for (int c = 0; c < kNumChannels; ++c)
+			for (int s = 0; s < n; ++s)
+				chunk[c][s] = static_cast<float>(inputs[c][offset + s]);
+
+		engine.ProcessChunk(chunk, chunk, NULL, n);
+
+		for (int c = 0; c < kNumChannels; ++c)
+			for (int s = 0; s < n; ++s)
+				outputs[c][offset + s] = chunk[c][s];
+	}
+}
+
+void bench_plugin(const Options& opts, std::vector<Result>& results)
+{
+	AudioCompressorEngine engine;
+	for (int block = kMinBlock; block <= kMaxBlock; block *= 2)
+	{
+		if (opts.selected("process_double"))
+		{
+			engine.Reset(kSampleRate, CompressorSettings());
+			Signal<double> sig(kNumChannels, block, false);
+			double** in = const_cast<double**>(&sig.in[0]);
+			const Result r = {"process_double", "double", kNumChannels, block,
+				measure([&]() {process_double(engine, in, &sig.out[0], block);}, kNumChannels, block, opts)};
+			results.push_back(r);
+			sig.accumulate();
+		}
+		if (opts.selected("process_single"))
+		{
+			engine.Reset(kSampleRate, CompressorSettings());
+			Signal<float> sig(kNumChannels, block, false);
+			const Result r = {"process_single", "float", kNumChannels, block,
+				measure([&]() {engine.Process(&sig.in[0], &sig.out[0], NULL, block);}, kNumChannels, block, opts)};
+			results.push_back(r);
+			sig.accumulate();
+		}
+	}
+}
+
+void write_json(FILE* f, const Options& opts, const std::vector<Result>& results)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"benchmark\": \"dsp_bench\",\n");
+	fprintf(f, "  \"unit\": \"ns/sample\",\n");
+	fprintf(f, "  \"sample_rate\": %.0f,\n", kSampleRate);
+	fprintf(f, "  \"min_time_ms\": %g,\n", opts.min_ms);
+	fprintf(f, "  \"repeats\": %d,\n", opts.repeats);
+	fprintf(f, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result& r = results[i];
+		fprintf(f, "    {\"kernel\": \"%s\", \"precision\": \"%s\", \"channels\": %d, \"block\": %d, "
+			"\"ns_per_sample\": %.4f}%s\n", r.kernel, r.precision, r.channels, r.block, r.ns_per_sample,
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+void write_table(FILE* f, const std::vector<Result>& results)
+{
+	fprintf(f, "%-20s %-9s %8s %6s %12s\n", "kernel", "precision", "channels", "block", "ns/sample");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result& r = results[i];
+		fprintf(f, "%-20s %-9s %8d %6d %12.3f\n", r.kernel, r.precision, r.channels, r.block, r.ns_per_sample);
+	}
+}
+
+void usage()
+{
+	fprintf(stderr,
+		"usage: dsp_bench [-o results.json] [-t min_ms] [-r repeats] [kernel...]\n"
+		"kernels: compressor compressor_soft_knee compressor_peak limiter arithmetic_mean geometric_mean harmonic_mean quadratic_mean\n"
+		"         generalized_mean fixed_order_mean process_double process_single\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	Options opts;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (0 == strcmp(argv[i], "-o") && i + 1 < argc)
+			opts.output = argv[++i];
+		else if (0 == strcmp(argv[i], "-t") && i + 1 < argc)
+			opts.min_ms = atof(argv[++i]);
+		else if (0 == strcmp(argv[i], "-r") && i + 1 < argc)
+			opts.repeats = atoi(argv[++i]);
+		else if ('-' == argv[i][0])
+		{
+			usage();
+			return 1;
+		}
+		else
+			opts.kernels.push_back(argv[i]);
+	}
+	if (opts.min_ms <= 0 || opts.repeats < 1)
+	{
+		usage();
+		return 1;
+	}
+
+	std::vector<Result> results;
+	bench_precision<float>(opts, results);
+	bench_precision<double>(opts, results);
+	bench_plugin(opts, results);
+
+	if (NULL == opts.output)
+		write_json(stdout, opts, results);
+	else
+	{
+		FILE* f = fopen(opts.output, "w");
+		if (NULL == f)
+		{
+			fprintf(stderr, "dsp_bench: can't write %s\n", opts.output);
+			return 1;
+		}
+		write_json(f, opts, results);
+		fclose(f);
+		write_table(stdout, results);
+	}
+	fprintf(stderr, "(checksum %g)\n", checksum);
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * CPU cost of the oversampled gain stage: the compressor and soft clip limiter of the plugin run
+ * between oversampler::upsample() and downsample(), at each factor, on stereo 256-sample chunks.
+ *
+ * Build and run from Plugin/AudioCompressor:
+ *   g++ -std=c++11 -O2 -DDSP_BOOST_DISABLED=1 -I. bench/oversampling_bench.cpp -o oversampling_bench
+ *   ./oversampling_bench
+ */
+#include "multiband.h"
+#include "dynamics.h"
+#include "oversampling.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const int kChannels = 2;
+const int kChunk = 256;
+const double kSampleRate = 48000.;
+const double kSeconds = 20.;
+
+// Runs kSeconds of noise through the chain, returns nanoseconds per base-rate sample frame.
+double run(int factor, double& checksum)
+{
+	const double rate = kSampleRate * factor;
+	dsp::multiband_compressor<float> comp(40, kChannels);
+	dsp::limiter<float, dsp::fast_tanh<float> > lim;
+	dsp::oversampler<float> os(kChannels, kChunk);
+	os.set_factor(factor);
+	comp.set_accuracy(dsp::accuracy_0_01dB);
+	comp.reserve_envelope(comp.bands(), static_cast<size_t>(rate * 0.01));
+	comp.set_envelope_period(static_cast<size_t>(rate * 0.01));
+	comp.set_attack(static_cast<float>(rate * 0.015));
+	comp.set_release(static_cast<float>(rate * 0.06));
+	comp.set_threshold_dB(-20);
+	comp.set_ratio(3);
+	comp.settle();
+
+	std::vector<float> input(kChannels * kChunk);
+	std::vector<float> output(kChannels * kChunk);
+	std::vector<float> oversampled(kChannels * kChunk * dsp::oversampler<float>::max_factor);
+	srand(1);
+	for (size_t i = 0; i < input.size(); ++i)
+		input[i] = 0.5f * (rand() / static_cast<float>(RAND_MAX) - 0.5f);
+
+	float* up[kChannels];
+	for (int c = 0; c < kChannels; ++c)
+		up[c] = &oversampled[c * kChunk * dsp::oversampler<float>::max_factor];
+
+	const long chunks = static_cast<long>(kSeconds * kSampleRate / kChunk);
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long k = 0; k < chunks; ++k)
+	{
+		for (int c = 0; c < kChannels; ++c)
+			os.upsample(&input[c * kChunk], up[c], kChunk, c);
+		comp.process(up, up, kChunk * factor);
+		for (int c = 0; c < kChannels; ++c)
+		{
+			lim.process(up[c], up[c], kChunk * factor);
+			os.downsample(up[c], &output[c * kChunk], kChunk, c);
+		}
+	}
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	for (size_t i = 0; i < output.size(); ++i)
+		checksum += output[i];
+	return ns / (chunks * kChunk);
+}
+
+}
+
+int main()
+{
+	double checksum = 0;
+	const double base = run(1, checksum);
+	printf("factor  latency  ns/frame  realtime  relative\n");
+	for (int factor = 1; factor <= dsp::oversampler<float>::max_factor; factor *= 2)
+	{
+		dsp::oversampler<float> os(kChannels, kChunk);
+		os.set_factor(factor);
+		const double ns = (1 == factor ? base : run(factor, checksum));
+		printf("%5dx  %7d  %8.1f  %7.0fx  %7.2fx\n", factor, static_cast<int>(os.latency()), ns,
+			1e9 / (ns * kSampleRate), ns / base);
+	}
+	printf("(checksum %g)\n", checksum);
+	return 0;
+}
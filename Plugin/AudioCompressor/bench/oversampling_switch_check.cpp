@@ -0,0 +1,138 @@
+/*
+ * Regression check for oversampling factor changes between blocks, as when the parameter is automated.
+ *
+ * The factor is passed to the engine with Update(), without Reset(), so it must take effect right away:
+ * Latency() must be the latency of an engine reset with that factor, and once the half-band filters
+ * have settled the output must be the input delayed by exactly Latency() samples. With the compressor
+ * at ratio 1 and a sine well below the limiter threshold the chain is linear, so the only difference
+ * left is the passband ripple of the half-band filters; a one sample misalignment is several times more.
+ *
+ * Build and run from Plugin/AudioCompressor/bench:
+ *   make
+ *   ./oversampling_switch_check [max_error]
+ * Exits with status 1 if the latency doesn't match, or if the output differs from the delayed input by
+ * more than max_error (default 0.002, relative to the amplitude) after any switch.
+ */
+#include "AudioCompressorEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const double kSampleRate = 48000.;
+const double kFrequency = 1000.;
+const double kAmplitude = 0.25;
+const int kBlock = 512;
+const int kSettleBlocks = 4;	// blocks after a switch before the output is compared
+const int kCheckBlocks = 4;
+
+struct Config
+{
+	const char* name;
+	int limiter_mode;
+	int factors[6];		// sequence of EOversampling values switched between, -1 terminated
+};
+
+CompressorSettings make_settings(const Config& config, int oversampling)
+{
+	CompressorSettings settings;
+	settings.preamp = 1.f;
+	settings.ratio = 1.f;
+	settings.limiter_mode = config.limiter_mode;
+	settings.oversampling = oversampling;
+	return settings;
+}
+
+int fresh_latency(const Config& config, int oversampling)
+{
+	AudioCompressorEngine engine;
+	engine.Reset(kSampleRate, make_settings(config, oversampling));
+	return engine.Latency();
+}
+
+// Largest difference between the output and the input delayed by latency, relative to the amplitude.
+double alignment_error(const std::vector<float>& in, const std::vector<float>& out, int from, int to, int latency)
+{
+	double worst = 0.;
+	for (int s = from; s < to; ++s)
+		worst = std::max(worst, std::fabs(static_cast<double>(out[s]) - in[s - latency]));
+	return worst / kAmplitude;
+}
+
+bool check(const Config& config, double maxError)
+{
+	int count = 0;
+	while (count < 6 && config.factors[count] >= 0)
+		++count;
+	const int blocksPerFactor = kSettleBlocks + kCheckBlocks;
+	const int length = count * blocksPerFactor * kBlock;
+
+	const double pi = 3.14159265358979323846;
+	std::vector<float> in(length), out[kNumChannels];
+	for (int s = 0; s < length; ++s)
+		in[s] = static_cast<float>(kAmplitude * std::sin(2. * pi * kFrequency * s / kSampleRate));
+	for (int c = 0; c < kNumChannels; ++c)
+		out[c].resize(length);
+
+	AudioCompressorEngine engine;
+	engine.Reset(kSampleRate, make_settings(config, config.factors[0]));
+	bool ok = true;
+	for (int i = 0; i < count; ++i)
+	{
+		const int factor = config.factors[i];
+		const int start = i * blocksPerFactor * kBlock;
+		engine.Update(make_settings(config, factor));
+		const int latency = engine.Latency();
+		const int expected = fresh_latency(config, factor);
+
+		for (int s = start; s < start + blocksPerFactor * kBlock; s += kBlock)
+		{
+			const float* pin[kNumChannels];
+			float* pout[kNumChannels];
+			for (int c = 0; c < kNumChannels; ++c)
+			{
+				pin[c] = &in[s];
+				pout[c] = &out[c][s];
+			}
+			engine.Process(pin, pout, NULL, kBlock);
+		}
+
+		const int from = start + kSettleBlocks * kBlock, to = start + blocksPerFactor * kBlock;
+		const double error = alignment_error(in, out[0], from, to, latency);
+		const double shifted = alignment_error(in, out[0], from, to, latency + 1);
+		const bool pass = (latency == expected && error <= maxError && shifted > maxError);
+		printf("%-24s %dx  latency %3d (fresh %3d)  error %9.2g  shifted by 1 %9.2g  %s\n", config.name,
+			1 << factor, latency, expected, error, shifted, pass ? "" : "FAIL");
+		ok = ok && pass;
+	}
+	return ok;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const double maxError = (argc > 1 ? atof(argv[1]) : 0.002);
+	if (maxError <= 0.)
+	{
+		fprintf(stderr, "usage: %s [max_error]\n", argv[0]);
+		return 2;
+	}
+
+	const Config configs[] = {
+		{"soft clip, up", kLimiterSoftClip, {kOversamplingOff, kOversampling2x, kOversampling4x, kOversampling8x, -1}},
+		{"soft clip, down", kLimiterSoftClip, {kOversampling8x, kOversampling4x, kOversampling2x, kOversamplingOff, -1}},
+		{"soft clip, jumps", kLimiterSoftClip, {kOversampling2x, kOversampling8x, kOversamplingOff, kOversampling4x, -1}},
+		{"look-ahead, up and down", kLimiterLookahead, {kOversamplingOff, kOversampling8x, kOversampling2x, -1}},
+	};
+
+	bool ok = true;
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i)
+		ok = check(configs[i], maxError) && ok;
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
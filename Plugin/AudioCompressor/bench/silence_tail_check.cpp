@@ -0,0 +1,281 @@
+/*
+ * Regression check for denormal stalls: noise fading out to digital silence is run through the
+ * processing chain in several configurations, and the cost per sample of each second of the silent
+ * tail is compared with the cost of the loud part. Recursive state (RMS window, gain smoothing, key
+ * filter and crossover memories) decays toward zero in the tail; if any of it falls into the denormal
+ * range the tail gets 10-50x slower, so a ratio above the limit fails the check.
+ *
+ * The chain is run both as the plugin runs it, inside WDL_DenormalFlushScope (FTZ/DAZ), and in the
+ * default FPU mode, where only the explicit flushing in dsp++ keeps the state out of denormals. The
+ * plugin detects RMS levels, so a peak-detecting dsp::compressor is checked on its own as well.
+ *
+ * Each run is repeated kRepetitions times and every second keeps its cheapest repetition, so that
+ * an interrupt or a frequency change during one repetition doesn't fail the check; a denormal stall
+ * slows down every repetition.
+ *
+ * Build and run from Plugin/AudioCompressor/bench:
+ *   make
+ *   ./silence_tail_check [max_ratio]
+ * Exits with status 1 if any configuration exceeds max_ratio (default 2).
+ */
+#include "AudioCompressorEngine.h"
+#include "denormal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAVE_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+namespace {
+
+const double kSampleRate = 48000.;
+const int kBlock = 256;
+const int kLoudSeconds = 2;
+const int kFadeSeconds = 1;
+const int kSilentSeconds = 10;
+const int kRepetitions = 5;
+
+// CPU cycles where the time stamp counter is available, nanoseconds otherwise.
+double ticks()
+{
+#ifdef HAVE_RDTSC
+	return static_cast<double>(__rdtsc());
+#else
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+const char* tick_unit()
+{
+#ifdef HAVE_RDTSC
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
+
+// Noise at -12 dBFS, an exponential fade by 108 dB, then exact zeros.
+void make_signal(std::vector<float>* channels)
+{
+	const int loud = static_cast<int>(kLoudSeconds * kSampleRate);
+	const int fade = static_cast<int>(kFadeSeconds * kSampleRate);
+	const int total = static_cast<int>((kLoudSeconds + kFadeSeconds + kSilentSeconds) * kSampleRate);
+	srand(1);
+	for (int c = 0; c < kNumChannels; ++c)
+	{
+		channels[c].assign(total, 0.f);
+		for (int s = 0; s < loud + fade; ++s)
+		{
+			const double level = 0.25 * (s < loud ? 1. : std::pow(10., -5.4 * (s - loud) / fade));
+			channels[c][s] = static_cast<float>(level * (rand() / static_cast<double>(RAND_MAX) - 0.5));
+		}
+	}
+}
+
+enum Detector
+{
+	kDetectorEngine,	// the plugin chain, RMS detection
+	kDetectorPeakBranching,
+	kDetectorPeakDecoupled,
+};
+
+struct Config
+{
+	const char* name;
+	CompressorSettings settings;
+	Detector detector;
+};
+
+class EngineChain
+{
+public:
+	explicit EngineChain(const CompressorSettings& settings) {engine.Reset(kSampleRate, settings);}
+	void Process(const float* const* in, float* const* out, int n) {engine.Process(in, out, NULL, n);}
+
+private:
+	AudioCompressorEngine engine;
+};
+
+// Peak-detecting compressor alone: detector attack and release from the settings, no gain smoothing.
+template<dsp::follower_mode Mode>
+class PeakChain
+{
+public:
+	explicit PeakChain(const CompressorSettings& settings)
+	 :	comp(static_cast<size_t>(kSampleRate*0.001*settings.release_ms + 0.5), kNumChannels)
+	{
+		comp.envelope().set_attack(static_cast<float>(kSampleRate*0.001*settings.attack_ms));
+		comp.set_threshold_dB(settings.threshold_dB);
+		comp.set_ratio(settings.ratio);
+		comp.set_gain_dB(settings.gain_dB);
+		comp.settle();
+	}
+	void Process(const float* const* in, float* const* out, int n) {comp.process(in, out, static_cast<size_t>(n));}
+
+private:
+	dsp::compressor<float, dsp::peak_follower<float, Mode> > comp;
+};
+
+// Adds the cost of each second of one pass over the signal, from a freshly reset chain, to cost.
+template<class Chain>
+void time_pass(const Config& config, const std::vector<float>* signal, bool flushScope, std::vector<double>* cost)
+{
+	const int total = static_cast<int>(signal[0].size());
+	const int second = static_cast<int>(kSampleRate);
+	Chain chain(config.settings);
+
+	std::vector<float> out[kNumChannels];
+	for (int c = 0; c < kNumChannels; ++c)
+		out[c].resize(total);
+
+	cost->assign(total / second, 0.);
+	const float* in[kNumChannels];
+	float* o[kNumChannels];
+	for (int offset = 0; offset + kBlock <= total; offset += kBlock)
+	{
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			in[c] = &signal[c][offset];
+			o[c] = &out[c][offset];
+		}
+		double t;
+		if (flushScope)
+		{
+			WDL_DenormalFlushScope denormalScope;
+			t = ticks();
+			chain.Process(in, o, kBlock);
+			t = ticks() - t;
+		}
+		else
+		{
+			t = ticks();
+			chain.Process(in, o, kBlock);
+			t = ticks() - t;
+		}
+		(*cost)[offset / second] += t;
+	}
+}
+
+template<class Chain>
+void time_config(const Config& config, const std::vector<float>* signal, bool flushScope, std::vector<double>* cost)
+{
+	std::vector<double> pass;
+	for (int r = 0; r < kRepetitions; ++r)
+	{
+		time_pass<Chain>(config, signal, flushScope, &pass);
+		if (0 == r)
+			*cost = pass;
+		else
+			for (size_t s = 0; s < cost->size(); ++s)
+				(*cost)[s] = std::min((*cost)[s], pass[s]);
+	}
+}
+
+// Returns the worst ratio of per-second cost in the tail to the cost of the loud part.
+double run(const Config& config, const std::vector<float>* signal, bool flushScope)
+{
+	const int second = static_cast<int>(kSampleRate);
+	std::vector<double> cost;
+	switch (config.detector)
+	{
+	case kDetectorPeakBranching:
+		time_config<PeakChain<dsp::follower_branching> >(config, signal, flushScope, &cost);
+		break;
+	case kDetectorPeakDecoupled:
+		time_config<PeakChain<dsp::follower_decoupled> >(config, signal, flushScope, &cost);
+		break;
+	default:
+		time_config<EngineChain>(config, signal, flushScope, &cost);
+		break;
+	}
+
+	// the first second warms up caches and branch predictors, the second one is the reference
+	const double reference = cost[1];
+	double worst = 0.;
+	int worstSecond = 0;
+	for (int s = kLoudSeconds; s < static_cast<int>(cost.size()); ++s)
+		if (cost[s] > worst)
+		{
+			worst = cost[s];
+			worstSecond = s;
+		}
+	const double ratio = worst / reference;
+	printf("%-22s %-8s %10.1f %10.1f  %6.2fx (at %ds)\n", config.name, flushScope ? "ftz/daz" : "default",
+		reference / second, worst / second, ratio, worstSecond);
+	return ratio;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const double maxRatio = (argc > 1 ? atof(argv[1]) : 2.);
+	if (maxRatio <= 1.)
+	{
+		fprintf(stderr, "usage: silence_tail_check [max_ratio > 1]\n");
+		return 1;
+	}
+
+	std::vector<float> signal[kNumChannels];
+	make_signal(signal);
+
+	std::vector<Config> configs;
+	Config c;
+	c.name = "defaults";
+	c.detector = kDetectorEngine;
+	configs.push_back(c);
+	c.name = "key high-pass";
+	c.settings.key_filter = kKeyFilterHighPass;
+	configs.push_back(c);
+	c.name = "3 bands, linked";
+	c.settings = CompressorSettings();
+	c.settings.bands = 3;
+	c.settings.link = dsp::link_max;
+	configs.push_back(c);
+	c.name = "2x, look-ahead";
+	c.settings = CompressorSettings();
+	c.settings.oversampling = kOversampling2x;
+	c.settings.limiter_mode = kLimiterLookahead;
+	configs.push_back(c);
+	c.name = "slow release, 5 bands";
+	c.settings = CompressorSettings();
+	c.settings.release_ms = 1000.f;
+	c.settings.rms_period_ms = 300.f;
+	c.settings.bands = 5;
+	configs.push_back(c);
+	c.name = "peak, branching";
+	c.settings = CompressorSettings();
+	c.settings.attack_ms = 1.f;
+	c.settings.release_ms = 100.f;
+	c.detector = kDetectorPeakBranching;
+	configs.push_back(c);
+	c.name = "peak, decoupled";
+	c.detector = kDetectorPeakDecoupled;
+	configs.push_back(c);
+
+	printf("%-22s %-8s %10s %10s  %s\n", "configuration", "fpu", "loud", "worst tail", "ratio");
+	printf("%-22s %-8s %10s %10s\n", "", "", tick_unit(), tick_unit());
+	int failed = 0;
+	for (size_t i = 0; i < configs.size(); ++i)
+		for (int scope = 1; scope >= 0; --scope)
+			if (run(configs[i], signal, 0 != scope) > maxRatio)
+				++failed;
+
+	if (failed > 0)
+	{
+		printf("FAILED: %d run(s) slower in the silent tail than %.1fx the loud part\n", failed, maxRatio);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
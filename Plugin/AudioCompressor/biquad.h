@@ -0,0 +1,159 @@
+/*!
+ * @file dsp++/biquad.h
+ * @brief Second-order IIR (biquad) sections designed with RBJ Audio EQ Cookbook formulas and their cascades.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_BIQUAD_H_INCLUDED
+#define DSP_BIQUAD_H_INCLUDED
+
+#include "config.h"
+#include "trivial_array.h"
+#include "fastmath.h"
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace dsp {
+
+//! @brief Butterworth quality factor, @f$1/\sqrt{2}@f$.
+const double butterworth_q = 0.70710678118654752;
+
+/*!
+ * @brief Coefficients of a biquad section normalized so that @f$a_0 = 1@f$:
+ * @f$H(z) = \frac{b_0 + b_1 z^{-1} + b_2 z^{-2}}{1 + a_1 z^{-1} + a_2 z^{-2}}@f$.
+ */
+template<class Sample>
+struct biquad_coefficients {
+	Sample b0, b1, b2, a1, a2;
+};
+
+//! @brief Response types supported by design_biquad().
+enum biquad_type {
+	biquad_passthrough,	//!< H(z) = 1.
+	biquad_lowpass,
+	biquad_highpass,
+	biquad_bandpass,	//!< constant 0 dB peak gain.
+	biquad_allpass,
+};
+
+/*!
+ * @brief Design biquad section (RBJ Audio EQ Cookbook).
+ * @param type response type.
+ * @param freq cutoff/center frequency normalized to sampling rate (0, 0.5).
+ * @param q quality factor.
+ */
+template<class Sample>
+biquad_coefficients<Sample> design_biquad(biquad_type type, double freq, double q = butterworth_q)
+{
+	const double pi = 3.14159265358979323846;
+	const double w = 2 * pi * std::min(std::max(freq, 1e-6), 0.499);
+	const double cw = std::cos(w);
+	const double alpha = std::sin(w) / (2 * q);
+	const double a0 = 1 + alpha;
+	double b0, b1, b2;
+	switch (type)
+	{
+	case biquad_lowpass: b0 = (1 - cw) / 2; b1 = 1 - cw; b2 = b0; break;
+	case biquad_highpass: b0 = (1 + cw) / 2; b1 = -(1 + cw); b2 = b0; break;
+	case biquad_bandpass: b0 = alpha; b1 = 0; b2 = -alpha; break;
+	case biquad_allpass: b0 = 1 - alpha; b1 = -2 * cw; b2 = 1 + alpha; break;
+	default:
+		{
+			biquad_coefficients<Sample> c = {Sample(1), Sample(), Sample(), Sample(), Sample()};
+			return c;
+		}
+	}
+	biquad_coefficients<Sample> c = {
+		static_cast<Sample>(b0 / a0), static_cast<Sample>(b1 / a0), static_cast<Sample>(b2 / a0),
+		static_cast<Sample>(-2 * cw / a0), static_cast<Sample>((1 - alpha) / a0)
+	};
+	return c;
+}
+
+namespace detail {
+
+/*!
+ * @brief Filter a block of samples through a single biquad section (transposed direct form II).
+ * @param c section coefficients.
+ * @param z 2 state variables of the section.
+ * @param in n input samples.
+ * @param out n output samples, may point to the same buffer as in.
+ */
+template<class Sample>
+inline void biquad_block(const biquad_coefficients<Sample>& c, Sample* z, const Sample* in, Sample* out, size_t n)
+{
+	Sample z0 = z[0], z1 = z[1];
+	for (size_t i = 0; i < n; ++i)
+	{
+		const Sample x = in[i];
+		const Sample y = c.b0 * x + z0;
+		z0 = c.b1 * x - c.a1 * y + z1;
+		z1 = c.b2 * x - c.a2 * y;
+		out[i] = y;
+	}
+	z[0] = flush_denormal(z0);	// once per block: the state decays into denormals when the input goes silent
+	z[1] = flush_denormal(z1);
+}
+
+}
+
+/*!
+ * @brief Cascade of biquad sections (transposed direct form II) applied to a number of independent channels.
+ * @tparam Sample type of processed samples.
+ */
+template<class Sample>
+class biquad_cascade {
+public:
+	/*!
+	 * @param sections number of sections, all initialized to passthrough.
+	 * @param channels number of independent channels.
+	 */
+	explicit biquad_cascade(size_t sections, size_t channels = 1)
+	 :	coeffs_(sections)
+	 ,	state_(sections * channels * 2, Sample())
+	 ,	channels_(channels)
+	{
+		const biquad_coefficients<Sample> c = design_biquad<Sample>(biquad_passthrough, 0);
+		std::fill(coeffs_.begin(), coeffs_.end(), c);
+	}
+
+	size_t sections() const {return coeffs_.size();}
+	size_t channels() const {return channels_;}
+
+	//! @brief Replace coefficients of i-th section, the state is preserved.
+	void set_section(size_t i, const biquad_coefficients<Sample>& c) {coeffs_[i] = c;}
+	const biquad_coefficients<Sample>& section(size_t i) const {return coeffs_[i];}
+
+	//! @brief Clear the state of all sections.
+	void reset() {std::fill(state_.begin(), state_.end(), Sample());}
+
+	/*!
+	 * @brief Filter a block of samples of one channel through all the sections.
+	 * @param in n input samples.
+	 * @param out n output samples, may point to the same buffer as in.
+	 * @param n number of samples.
+	 * @param channel channel index, selects the state used.
+	 */
+	void process(const Sample* in, Sample* out, size_t n, size_t channel = 0)
+	{
+		const size_t S = coeffs_.size();
+		if (0 == S)
+		{
+			if (in != out)
+				std::copy(in, in + n, out);
+			return;
+		}
+		for (size_t s = 0; s < S; ++s, in = out)	// section by section over the whole block
+			detail::biquad_block(coeffs_[s], state_.get() + (s * channels_ + channel) * 2, in, out, n);
+	}
+
+private:
+	trivial_array<biquad_coefficients<Sample> > coeffs_;
+	trivial_array<Sample> state_;	//!< 2 state variables for each channel of each section (section-major)
+	size_t channels_;
+};
+
+}
+
+#endif /* DSP_BIQUAD_H_INCLUDED */
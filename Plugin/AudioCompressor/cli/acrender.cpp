@@ -0,0 +1,362 @@
+// acrender: offline batch renderer running the AudioCompressor chain over WAV files, without a host.
+//
+// Files are distributed over worker threads, each with its own AudioCompressorEngine, and the output
+// is latency-compensated, i.e. sample-aligned with the input. See Usage() for options.
+
+#include <stdlib.h>
+#include <string.h>
+#include "wavwrite.h"
+#include "denormal.h"
+
+#include "AudioCompressorEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+	Options() : blockSize(512), bits(24), jobs(0) {}
+
+	CompressorSettings settings;
+	int blockSize;
+	int bits;
+	int jobs;
+	std::string outDir;
+	std::string suffix;
+	std::vector<std::string> files;
+};
+
+struct Result
+{
+	Result() : ok(false), seconds(0.), cpuSeconds(0.), maxReduction(0.f) {}
+
+	bool ok;
+	std::string error;
+	double seconds;		// duration of the audio
+	double cpuSeconds;	// time spent in the engine
+	float maxReduction;
+};
+
+void Usage()
+{
+	fprintf(stderr,
+		"usage: acrender [options] input.wav...\n"
+		"  -o DIR               output directory (default: next to the input)\n"
+		"  -s SUFFIX            output name suffix (default: \"-compressed\" unless -o is given)\n"
+		"  -j N                 worker threads (default: number of cores)\n"
+		"  -b N                 block size in frames (default: 512)\n"
+		"  --bits 16|24         output sample format (default: 24)\n"
+		"  --preamp PERCENT     input gain, 100 = unity (default: 50, as in the plugin)\n"
+		"  --rms MS             RMS period (default: 10)\n"
+		"  --attack MS          (default: 15)\n"
+		"  --release MS         (default: 60)\n"
+		"  --threshold DB       (default: -20)\n"
+		"  --ratio R            (default: 3)\n"
+		"  --knee DB            soft knee width, 0 = hard (default: 0)\n"
+		"  --gain DB            makeup gain (default: 0)\n"
+		"  --link none|max|sum  stereo link (default: none)\n"
+		"  --limiter softclip|lookahead\n"
+		"  --lookahead MS       (default: 1.5)\n"
+		"  --bands N            1..%d (default: 1)\n"
+		"  --crossover K=HZ     crossover K (1..%d) frequency\n"
+		"  --oversampling 1|2|4|8\n"
+		"Mono and stereo files are supported; the output has the channel count of the input.\n",
+		kNumCrossovers + 1, kNumCrossovers);
+}
+
+bool ParseOptions(int argc, char** argv, Options* pOpts)
+{
+	CompressorSettings& s = pOpts->settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if ('-' != arg[0] || 1 == arg.size())
+		{
+			pOpts->files.push_back(arg);
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "acrender: missing value for %s\n", arg.c_str());
+			return false;
+		}
+		const char* value = argv[++i];
+		if ("-o" == arg) pOpts->outDir = value;
+		else if ("-s" == arg) pOpts->suffix = value;
+		else if ("-j" == arg) pOpts->jobs = atoi(value);
+		else if ("-b" == arg) pOpts->blockSize = atoi(value);
+		else if ("--bits" == arg) pOpts->bits = atoi(value);
+		else if ("--preamp" == arg) s.preamp = static_cast<float>(atof(value) / 100.);
+		else if ("--rms" == arg) s.rms_period_ms = static_cast<float>(atof(value));
+		else if ("--attack" == arg) s.attack_ms = static_cast<float>(atof(value));
+		else if ("--release" == arg) s.release_ms = static_cast<float>(atof(value));
+		else if ("--threshold" == arg) s.threshold_dB = static_cast<float>(atof(value));
+		else if ("--ratio" == arg) s.ratio = static_cast<float>(atof(value));
+		else if ("--knee" == arg) s.knee_dB = static_cast<float>(atof(value));
+		else if ("--gain" == arg) s.gain_dB = static_cast<float>(atof(value));
+		else if ("--lookahead" == arg) s.lookahead_ms = static_cast<float>(atof(value));
+		else if ("--bands" == arg) s.bands = atoi(value);
+		else if ("--link" == arg)
+		{
+			if (!strcmp(value, "none")) s.link = dsp::link_none;
+			else if (!strcmp(value, "max")) s.link = dsp::link_max;
+			else if (!strcmp(value, "sum")) s.link = dsp::link_sum;
+			else return false;
+		}
+		else if ("--limiter" == arg)
+		{
+			if (!strcmp(value, "softclip")) s.limiter_mode = kLimiterSoftClip;
+			else if (!strcmp(value, "lookahead")) s.limiter_mode = kLimiterLookahead;
+			else return false;
+		}
+		else if ("--crossover" == arg)
+		{
+			int k;
+			double hz;
+			if (2 != sscanf(value, "%d=%lf", &k, &hz) || k < 1 || k > kNumCrossovers)
+				return false;
+			s.crossover_Hz[k - 1] = static_cast<float>(hz);
+		}
+		else if ("--oversampling" == arg)
+		{
+			int f = atoi(value), mode = 0;
+			while (mode < kNumOversamplingModes - 1 && (2 << mode) <= f)
+				++mode;
+			s.oversampling = mode;
+		}
+		else
+		{
+			fprintf(stderr, "acrender: unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	if (pOpts->files.empty() || pOpts->blockSize <= 0 || (16 != pOpts->bits && 24 != pOpts->bits)
+		|| s.bands < 1 || s.bands > kNumCrossovers + 1)
+		return false;
+	if (pOpts->suffix.empty() && pOpts->outDir.empty())
+		pOpts->suffix = "-compressed";
+	return true;
+}
+
+unsigned int ReadLE(const unsigned char* p, int bytes)
+{
+	unsigned int v = 0;
+	for (int i = bytes - 1; i >= 0; --i)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+// Reads PCM (16, 24, 32 bit) or IEEE float (32, 64 bit) WAV into planar float channels.
+bool ReadWav(const std::string& path, std::vector<std::vector<float> >* pChannels, int* pSampleRate, std::string* pError)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (!fp)
+	{
+		*pError = "cannot open";
+		return false;
+	}
+	std::vector<unsigned char> file;
+	unsigned char buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		file.insert(file.end(), buf, buf + n);
+	fclose(fp);
+
+	if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) || memcmp(&file[8], "WAVE", 4))
+	{
+		*pError = "not a WAV file";
+		return false;
+	}
+	int format = 0, nch = 0, bps = 0;
+	const unsigned char* data = NULL;
+	size_t dataBytes = 0;
+	for (size_t pos = 12; pos + 8 <= file.size(); )
+	{
+		const unsigned char* chunk = &file[pos];
+		const size_t size = ReadLE(chunk + 4, 4);
+		const size_t avail = std::min(size, file.size() - pos - 8);
+		if (!memcmp(chunk, "fmt ", 4) && avail >= 16)
+		{
+			format = ReadLE(chunk + 8, 2);
+			nch = ReadLE(chunk + 10, 2);
+			*pSampleRate = ReadLE(chunk + 12, 4);
+			bps = ReadLE(chunk + 22, 2);
+			if (0xFFFE == format && avail >= 26)		// WAVE_FORMAT_EXTENSIBLE, format from subformat GUID
+				format = ReadLE(chunk + 32, 2);
+		}
+		else if (!memcmp(chunk, "data", 4))
+		{
+			data = chunk + 8;
+			dataBytes = avail;
+		}
+		pos += 8 + size + (size & 1);
+	}
+	const bool pcm = (1 == format && (16 == bps || 24 == bps || 32 == bps));
+	const bool ieee = (3 == format && (32 == bps || 64 == bps));
+	if (!data || nch < 1 || nch > kNumChannels || *pSampleRate <= 0 || !(pcm || ieee))
+	{
+		*pError = "unsupported format (mono/stereo PCM 16/24/32 or float 32/64 only)";
+		return false;
+	}
+
+	const int frameBytes = nch * bps / 8;
+	const int frames = static_cast<int>(dataBytes / frameBytes);
+	if (0 == frames)
+	{
+		*pError = "no audio data";
+		return false;
+	}
+	pChannels->assign(nch, std::vector<float>(frames));
+	for (int c = 0; c < nch; ++c)
+	{
+		float* dest = &(*pChannels)[c][0];
+		const unsigned char* src = data + c * bps / 8;
+		if (pcm)
+			pcmToFloats(const_cast<unsigned char*>(src), frames, bps, nch, dest, 1);
+		else if (32 == bps)
+			for (int i = 0; i < frames; ++i)
+				memcpy(&dest[i], src + i * frameBytes, sizeof(float));
+		else
+			for (int i = 0; i < frames; ++i)
+			{
+				double d;
+				memcpy(&d, src + i * frameBytes, sizeof(double));
+				dest[i] = static_cast<float>(d);
+			}
+	}
+	return true;
+}
+
+std::string OutputPath(const Options& opts, const std::string& in)
+{
+	std::string dir, name = in;
+	const size_t slash = in.find_last_of('/');
+	if (std::string::npos != slash)
+	{
+		dir = in.substr(0, slash + 1);
+		name = in.substr(slash + 1);
+	}
+	if (!opts.outDir.empty())
+		dir = opts.outDir + "/";
+	const size_t dot = name.find_last_of('.');
+	const std::string base = (std::string::npos == dot ? name : name.substr(0, dot));
+	return dir + base + opts.suffix + ".wav";
+}
+
+Result Render(AudioCompressorEngine& engine, const Options& opts, const std::string& path)
+{
+	Result result;
+	std::vector<std::vector<float> > input;
+	int sampleRate = 0;
+	if (!ReadWav(path, &input, &sampleRate, &result.error))
+		return result;
+
+	const int nch = static_cast<int>(input.size());
+	const int frames = static_cast<int>(input[0].size());
+	result.seconds = static_cast<double>(frames) / sampleRate;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	engine.Reset(sampleRate, opts.settings);
+	const int latency = engine.Latency();
+
+	// the input is followed by latency frames of silence, and the first latency output frames are dropped
+	const int total = frames + latency;
+	const int B = opts.blockSize;
+	std::vector<float> in(kNumChannels * B), out(kNumChannels * B), interleaved(nch * B);
+	const float* inPtr[kNumChannels];
+	float* outPtr[kNumChannels];
+	for (int c = 0; c < kNumChannels; ++c)
+	{
+		inPtr[c] = &in[c * B];
+		outPtr[c] = &out[c * B];
+	}
+
+	WaveWriter writer;
+	const std::string outPath = OutputPath(opts, path);
+	if (!writer.Open(outPath.c_str(), opts.bits, nch, sampleRate, 0))
+	{
+		result.error = "cannot create " + outPath;
+		return result;
+	}
+
+	for (int offset = 0; offset < total; offset += B)
+	{
+		const int n = std::min(total - offset, B);
+		for (int c = 0; c < kNumChannels; ++c)
+		{
+			const std::vector<float>& src = input[c < nch ? c : 0];		// mono feeds both channels
+			for (int i = 0; i < n; ++i)
+				in[c * B + i] = (offset + i < frames ? src[offset + i] : 0.f);
+		}
+		result.maxReduction = std::max(result.maxReduction, engine.Process(inPtr, outPtr, NULL, n));
+
+		const int skip = std::max(0, std::min(latency - offset, n));
+		const int m = n - skip;
+		for (int i = 0; i < m; ++i)
+			for (int c = 0; c < nch; ++c)
+				interleaved[i * nch + c] = out[c * B + skip + i];
+		writer.WriteFloats(&interleaved[0], m * nch);
+	}
+	result.cpuSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.ok = true;
+	return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	Options opts;
+	if (!ParseOptions(argc, argv, &opts))
+	{
+		Usage();
+		return 2;
+	}
+
+	const int nFiles = static_cast<int>(opts.files.size());
+	int jobs = (opts.jobs > 0 ? opts.jobs : static_cast<int>(std::thread::hardware_concurrency()));
+	jobs = std::max(1, std::min(jobs, nFiles));
+
+	// workers take the next file from a shared counter, so long files don't hold up the rest
+	std::vector<Result> results(nFiles);
+	std::atomic<int> next(0);
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int j = 0; j < jobs; ++j)
+		workers.push_back(std::thread([&]()
+		{
+			WDL_DenormalFlushScope denormalScope;	// as IPlugBase::ProcessBuffers() does for the plugin
+			AudioCompressorEngine engine;
+			for (int i; (i = next++) < nFiles; )
+				results[i] = Render(engine, opts, opts.files[i]);
+		}));
+	for (size_t j = 0; j < workers.size(); ++j)
+		workers[j].join();
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failed = 0;
+	double audio = 0.;
+	for (int i = 0; i < nFiles; ++i)
+	{
+		const Result& r = results[i];
+		if (!r.ok)
+		{
+			fprintf(stderr, "%s: %s\n", opts.files[i].c_str(), r.error.c_str());
+			++failed;
+			continue;
+		}
+		audio += r.seconds;
+		printf("%s: %.2f s, max gain reduction %.1f dB, %.0fx real-time\n", opts.files[i].c_str(), r.seconds,
+			r.maxReduction, r.cpuSeconds > 0. ? r.seconds / r.cpuSeconds : 0.);
+	}
+	printf("%d file(s), %.2f s of audio in %.2f s on %d thread(s): %.0fx real-time\n", nFiles - failed, audio,
+		wall, jobs, wall > 0. ? audio / wall : 0.);
+	return (failed ? 1 : 0);
+}
@@ -9,80 +9,380 @@
 #include "config.h"
 #include "algorithm.h""
 #include "mean.h"
+#include "envelope.h"
 #include "complex.h"
+#include "fastmath.h"
+#include "soft_clip.h"
+#include "smoothing.h"
 
 #include <limits>
 #include <algorithm>
 
 namespace dsp {
 
+/*!
+ * @brief How the channels of a multichannel compressor are linked together.
+ */
+enum compressor_link {
+	link_none,	//!< each channel has its own detector and gain.
+	link_max,	//!< all channels share gain derived from the loudest channel level.
+	link_sum,	//!< all channels share gain derived from the sum of channel levels.
+};
+
+/*!
+ * @brief Feed-forward compressor with RMS (or other Envelope) level detection.
+ * The gain computer is specialized at compile time for each combination of log2()/exp2() accuracy, knee
+ * type (hard or soft) and parameter state (fixed, or ramping after a change of threshold or ratio), and
+ * metering is a template parameter of the block loop, so the per-sample loops carry no branches for
+ * features which aren't in use. The specialization is picked by a member function pointer reselected
+ * in the setters, and per block between the fixed and the ramping variant.
+ * The detector is selected at compile time with Envelope, e.g. quadratic_mean (RMS, the default) or
+ * peak_follower (peak).
+ * @tparam Sample type of processed samples.
+ * @tparam Envelope level detector, must be constructible with (period, initial condition, channel count)
+ * and provide <tt>Sample operator()(Sample)</tt> for single-channel use and
+ * <tt>void process_frame(const Sample*, Sample*)</tt> for multichannel use.
+ */
 template<class Sample, class Envelope = dsp::quadratic_mean<Sample> >
 class compressor: public dsp::sample_based_transform<Sample> {
 public:
 
-	explicit compressor(size_t envelope_L)
-	 :	envelope_(envelope_L)
-	 ,	threshold_(0)
-	 ,	gain_(1.f)
+	/*!
+	 * @param envelope_L period of the envelope detector.
+	 * @param channels number of channels processed by the multichannel process().
+	 */
+	explicit compressor(size_t envelope_L, size_t channels = 1)
+	 :	envelope_(envelope_L, Sample(), channels)
+	 ,	threshold_log2_(fast_log2<accuracy_exact>(0.f))
+	 ,	makeup_log2_(0.f)
 	 ,	ratio_(1.f)
-	 ,	attack_delta_(1.)
-	 ,	release_delta_(1.)
-	 ,	transition_(0)
+	 ,	knee_log2_(0.f)
+	 ,	attack_()
+	 ,	release_()
+	 ,	state_(channels, Sample())
+	 ,	accuracy_(accuracy_exact)
+	 ,	link_(link_none)
+	 ,	frame_(channels)
+	 ,	level_(channels * block_size)
+	 ,	gain_log2_(channels * block_size)
+	{
+		select_gain_computer();
+	}
+
+	/*
+	 * Threshold and makeup gain are kept in log2 domain, so setting them in dB is a mere scaling.
+	 * Threshold, makeup gain and ratio follow the values set here smoothly, see set_smoothing().
+	 */
+	float threshold_dB() const {return log2_to_dB * threshold_log2_.target();}
+	float threshold() const {return fast_exp2<accuracy_exact>(threshold_log2_.target());}
+	void set_threshold_dB(float t) {threshold_log2_.set_target(dB_to_log2 * t);}
+	void set_threshold(float t) {threshold_log2_.set_target(fast_log2<accuracy_exact>(t));}
+
+	float gain_dB() const {return log2_to_dB * makeup_log2_.target();}
+	float gain() const {return fast_exp2<accuracy_exact>(makeup_log2_.target());}
+	void set_gain_dB(float g) {makeup_log2_.set_target(dB_to_log2 * g);}
+	void set_gain(float g) {makeup_log2_.set_target(fast_log2<accuracy_exact>(g));}
+
+	float ratio() const {return ratio_.target();}
+	void set_ratio(float r) {ratio_.set_target(r);}
+
+	/*!
+	 * @brief Set width of the soft knee, centered on the threshold, over which the ratio goes gradually
+	 * from 1 to ratio(); unlike threshold and ratio it isn't smoothed.
+	 * @param w knee width in dB, 0 (the default) is a hard knee.
+	 */
+	void set_knee_dB(float w) {knee_log2_ = dB_to_log2 * std::max(w, 0.f); select_gain_computer();}
+	float knee_dB() const {return log2_to_dB * knee_log2_;}
+
+	/*!
+	 * @brief Set time constant of the per-sample ramps threshold, makeup gain and ratio follow on change.
+	 * @param samples time constant in samples, 0 (the default) means parameters change instantly.
+	 */
+	void set_smoothing(float samples)
+	{
+		threshold_log2_.set_time_constant(samples);
+		makeup_log2_.set_time_constant(samples);
+		ratio_.set_time_constant(samples);
+	}
+
+	//! @brief Jump to the last set threshold, makeup gain and ratio without ramping, e.g. after reset.
+	void settle()
 	{
+		threshold_log2_.settle();
+		makeup_log2_.settle();
+		ratio_.settle();
 	}
 
-	float threshold_dB() const {return 20.f * std::log10(threshold_);}
-	float threshold() const {return threshold_;}
-	void set_threshold_dB(float t) {threshold_ = std::pow(10.f, t/20.f);}
-	void set_threshold(float t) {threshold_ = t;}
+	/*!
+	 * @brief Set attack time of the gain reduction (RC-style exponential response).
+	 * @param samples time constant in samples (fractional values are fine), 0 means instantaneous attack.
+	 */
+	void set_attack(Sample samples) {attack_ = one_pole_coefficient(samples);}
+	/*!
+	 * @brief Set release time of the gain reduction (RC-style exponential response).
+	 * @param samples time constant in samples (fractional values are fine), 0 means instantaneous release.
+	 */
+	void set_release(Sample samples) {release_ = one_pole_coefficient(samples);}
 
-	float gain_dB() const {return 20.f * std::log10(gain_);}
-	float gain() const {return gain_;}
-	void set_gain_dB(float g) {gain_ = std::pow(10.f, g/20.f);}
-	void set_gain(float g) {gain_ = g;}
+	/*!
+	 * @brief Select the accuracy of log2()/exp2() used by the gain computer.
+	 * @param a one of math_accuracy values; accuracy_exact (the default) uses the standard library functions.
+	 */
+	void set_accuracy(math_accuracy a) {accuracy_ = a; select_gain_computer();}
+	math_accuracy accuracy() const {return accuracy_;}
 
-	float ratio() const {return ratio_;}
-	void set_ratio(float r) {ratio_ = r;}
+	/*!
+	 * @brief Select how channels are linked in multichannel process().
+	 * @param l one of compressor_link values; link_none (the default) processes channels independently.
+	 */
+	void set_link(compressor_link l) {link_ = l;}
+	compressor_link link() const {return link_;}
 
-	void set_attack(size_t sample_count) {attack_delta_ = 1. / sample_count;}
-	void set_release(size_t sample_count) {release_delta_ = 1. / sample_count;}
+	size_t channels() const {return state_.size();}
 
+	//! @return the envelope detector, e.g. to change its period.
+	Envelope& envelope() {return envelope_;}
+	const Envelope& envelope() const {return envelope_;}
+
+	//! @pre channels() == 1
 	Sample operator()(Sample x, float* compression_dB = NULL) 
 	{
-		float ref = static_cast<float>(std::abs(envelope_(x)));			// get signal level from envelope detector
-		if (ref > threshold_)
-			transition_ = std::min(1., transition_ + attack_delta_);	// adjust transition value according to attack or release time
-		else if (ref < threshold_)
-			transition_ = std::max(0., transition_ - release_delta_);
+		process(&x, &x, 1, compression_dB);
+		return x;
+	}
+
+	/*!
+	 * @brief Process a block of samples.
+	 * @param in n input samples.
+	 * @param out n output samples, may point to the same buffer as in.
+	 * @param n number of samples to process.
+	 * @param compression_dB optional array receiving n gain reduction values (in dB), may be NULL.
+	 * @pre channels() == 1
+	 */
+	void process(const Sample* in, Sample* out, size_t n, float* compression_dB = NULL)
+	{
+		process<Sample, Sample, Sample>(&in, &out, &in, n, compression_dB);
+	}
+
+	/*!
+	 * @brief Process a block of channels() planar channels.
+	 * The detector, gain computer and gain application run as separate loops over sub-blocks of at most
+	 * block_size samples, so that there's no per-sample call overhead and the gain application loop
+	 * may be vectorized by the compiler. Intermediate per-channel state is laid out frame by frame
+	 * (structure-of-arrays), so the inner loops over channels are vectorizable as well.
+	 * @param in channels() arrays of n input samples.
+	 * @param out channels() arrays of n output samples, may point to the same buffers as in.
+	 * @param n number of samples to process.
+	 * @param compression_dB optional array receiving n gain reduction values (in dB) of the most
+	 * compressed channel, may be NULL.
+	 */
+	template<class In, class Out>
+	void process(const In* const* in, Out* const* out, size_t n, float* compression_dB = NULL)
+	{
+		process<In, Out, In>(in, out, in, n, compression_dB);
+	}
+
+	/*!
+	 * @brief Process a block of channels() planar channels with external key (sidechain) signal: the
+	 * detector reads key channels, while the gain is applied to in.
+	 * @param in channels() arrays of n input samples.
+	 * @param out channels() arrays of n output samples, may point to the same buffers as in.
+	 * @param key channels() arrays of n key samples.
+	 * @param n number of samples to process.
+	 * @param compression_dB optional array receiving n gain reduction values (in dB), may be NULL.
+	 */
+	template<class In, class Out, class Key>
+	void process(const In* const* in, Out* const* out, const Key* const* key, size_t n, float* compression_dB = NULL)
+	{
+		if (NULL == compression_dB)
+			process_channels<In, Out, Key, false>(in, out, key, n, NULL);
+		else
+			process_channels<In, Out, Key, true>(in, out, key, n, compression_dB);
+	}
 
-		float ratio = 1.f + static_cast<float>(transition_) * (ratio_ - 1.f);	// calculate compression ratio based on current transition value
+	//! @brief Maximum number of samples process() handles in a single pass (size of intermediate buffers).
+	enum {block_size = 64};
 
-		float rel = ref / threshold_;			// signal level w/ reference to threshold
-		if (ratio != 1.f)
-			rel = std::pow(rel, 1.f / ratio);	// scale dB value by ratio (signal level w/reference to threshold after gain is applied)
+private:
+	//! @brief Gain computer specialization, see compute_gain().
+	typedef void (compressor::*gain_computer)(const Sample* level, float* gain_log2, size_t n, size_t G);
 
-		float gain = threshold_ * rel / ref;	// calculate actual gain
-		if (NULL != compression_dB)
+	template<math_accuracy Accuracy>
+	void select_gain_computer()
+	{
+		if (knee_log2_ > 0.f)
+		{
+			gain_computer_[0] = &compressor::compute_gain<Accuracy, true, false>;
+			gain_computer_[1] = &compressor::compute_gain<Accuracy, true, true>;
+		}
+		else
 		{
-			if (0.f == gain)
-				*compression_dB = 20.f * std::log10(std::numeric_limits<float>::epsilon());
-			else
-				*compression_dB = 20.f * std::log10(gain);
+			gain_computer_[0] = &compressor::compute_gain<Accuracy, false, false>;
+			gain_computer_[1] = &compressor::compute_gain<Accuracy, false, true>;
 		}
+	}
 
-		gain *= gain_;							// apply additional gain set as param
-		x = static_cast<Sample>(gain * x);		// amplify the sample
-		return x;
+	//! @brief Dispatcher, called when accuracy or knee changes.
+	void select_gain_computer()
+	{
+		switch (accuracy_)
+		{
+		case accuracy_0_01dB: select_gain_computer<accuracy_0_01dB>(); break;
+		case accuracy_0_1dB: select_gain_computer<accuracy_0_1dB>(); break;
+		default: select_gain_computer<accuracy_exact>(); break;
+		}
+	}
+
+	//! @tparam Metering whether compression_dB is written; when false it is NULL.
+	template<class In, class Out, class Key, bool Metering>
+	void process_channels(const In* const* in, Out* const* out, const Key* const* key, size_t n, float* compression_dB)
+	{
+		const size_t C = channels();
+		const size_t G = (link_none == link_ ? C : 1);	// number of independent gains
+		Sample* frame = frame_.get();
+		Sample* level = level_.get();
+		float* gain = gain_log2_.get();
+		for (size_t off = 0; off < n; off += block_size)
+		{
+			const size_t len = std::min(n - off, static_cast<size_t>(block_size));
+			for (size_t i = 0; i < len; ++i)	// detector
+			{
+				for (size_t c = 0; c < C; ++c)
+					frame[c] = static_cast<Sample>(key[c][off + i]);
+				envelope_.process_frame(frame, level + i * C);
+			}
+
+			if (link_max == link_)				// linking, level of frame i is compacted to level[i]
+				for (size_t i = 0; i < len; ++i)
+				{
+					Sample l = std::abs(level[i * C]);
+					for (size_t c = 1; c < C; ++c)
+						l = std::max(l, static_cast<Sample>(std::abs(level[i * C + c])));
+					level[i] = l;
+				}
+			else if (link_sum == link_)
+				for (size_t i = 0; i < len; ++i)
+				{
+					Sample l = std::abs(level[i * C]);
+					for (size_t c = 1; c < C; ++c)
+						l += std::abs(level[i * C + c]);
+					level[i] = l;
+				}
+
+			const bool ramping = !(threshold_log2_.settled() && ratio_.settled());
+			(this->*gain_computer_[ramping])(level, gain, len, G);	// gain computer
+
+			if (Metering)						// metering
+				for (size_t i = 0; i < len; ++i)
+				{
+					float g = gain[i * G];
+					for (size_t c = 1; c < G; ++c)
+						g = std::min(g, gain[i * G + c]);
+					compression_dB[off + i] = log2_to_dB * g;
+				}
+
+			switch (accuracy_)					// gain to linear domain with makeup gain applied
+			{
+			case accuracy_0_01dB: to_linear<accuracy_0_01dB>(gain, len, G); break;
+			case accuracy_0_1dB: to_linear<accuracy_0_1dB>(gain, len, G); break;
+			default: to_linear<accuracy_exact>(gain, len, G); break;
+			}
+
+			for (size_t c = 0; c < C; ++c)		// gain application
+			{
+				const In* x = in[c] + off;
+				Out* y = out[c] + off;
+				const float* g = gain + (1 == G ? 0 : c);
+				for (size_t i = 0; i < len; ++i)
+					y[i] = static_cast<Out>(g[i * G] * x[i]);
+			}
+		}
+	}
+
+	/*!
+	 * @brief Gain computer evaluated in log2 domain: with signal level and threshold expressed as
+	 * @f$\log_2@f$ values, the static curve is @f$2^{\max(l - t, 0)(1/r - 1)}@f$ and gain reduction in dB
+	 * is a mere scaling of the exponent, so there's no per-sample pow()/log10(). With soft knee of width
+	 * w, @f$\max(o, 0)@f$ of the overshoot @f$o = l - t@f$ is replaced by the quadratic blend
+	 * @f$q^2/2w + \max(o - w/2, 0)@f$, @f$q = \min(\max(o + w/2, 0), w)@f$, which is continuous with
+	 * continuous slope at both ends of the knee. The static gain is then smoothed with a one-pole filter
+	 * using attack coefficient when gain reduction grows and release coefficient when it decays; the
+	 * coefficient is selected without branching.
+	 * @tparam SoftKnee whether knee_log2_ is nonzero.
+	 * @tparam Ramping whether threshold or ratio is moving toward a new value; otherwise both are constant
+	 * over the block and ramps aren't advanced.
+	 */
+	template<math_accuracy Accuracy, bool SoftKnee, bool Ramping>
+	void compute_gain(const Sample* level, float* gain_log2, size_t n, size_t G)
+	{
+		Sample* state = state_.get();
+		const Sample attack = attack_;
+		const Sample release = release_;
+		const float knee = knee_log2_;
+		const float inv_2knee = (SoftKnee ? 0.5f / knee : 0.f);
+		float threshold = threshold_log2_.value();
+		float slope = 1.f / ratio_.value() - 1.f;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (Ramping)
+			{
+				threshold = threshold_log2_();
+				if (!ratio_.settled())
+					slope = 1.f / ratio_() - 1.f;
+			}
+			for (size_t c = 0; c < G; ++c)
+			{
+				const float over = fast_log2<Accuracy>(static_cast<float>(std::abs(level[i * G + c]))) - threshold;
+				float above;
+				if (SoftKnee)
+				{
+					const float q = std::min(std::max(over + 0.5f * knee, 0.f), knee);
+					above = q * q * inv_2knee + std::max(over - 0.5f * knee, 0.f);
+				}
+				else
+					above = std::max(over, 0.f);
+				const Sample target = static_cast<Sample>(above * slope);
+				const Sample k = (target < state[c] ? attack : release);
+				state[c] = target + k * (state[c] - target);
+				gain_log2[i * G + c] = static_cast<float>(state[c]);
+			}
+		}
+		flush_denormals(state, G);	// release decays toward 0 (no gain reduction) exponentially
+	}
+
+	//! @brief Convert n frames of G gains to linear domain, applying makeup gain in the exponent.
+	template<math_accuracy Accuracy>
+	void to_linear(float* gain, size_t n, size_t G)
+	{
+		if (makeup_log2_.settled())
+		{
+			const float makeup = makeup_log2_.value();
+			for (size_t i = 0; i < n * G; ++i)
+				gain[i] = fast_exp2<Accuracy>(gain[i] + makeup);
+			return;
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			const float makeup = makeup_log2_();
+			for (size_t c = 0; c < G; ++c)
+				gain[i * G + c] = fast_exp2<Accuracy>(gain[i * G + c] + makeup);
+		}
 	}
 
-private:
 	Envelope envelope_;
-	float threshold_;
-	float gain_;
-	float ratio_;
-	double attack_delta_;
-	double release_delta_;
-	double transition_;
+	smoothed_value<float> threshold_log2_;
+	smoothed_value<float> makeup_log2_;
+	smoothed_value<float> ratio_;
+	float knee_log2_;						//!< soft knee width in log2 units, 0 for hard knee
+	gain_computer gain_computer_[2];		//!< compute_gain() specializations for current accuracy and knee: fixed, ramping
+	Sample attack_;
+	Sample release_;
+	trivial_array<Sample> state_;			//!< smoothed gain (log2) of each channel (only the first one is used when linked)
+	math_accuracy accuracy_;
+	compressor_link link_;
+	trivial_array<Sample> frame_;			//!< input frame passed to the detector
+	trivial_array<Sample> level_;			//!< block_size frames of detector output
+	trivial_array<float> gain_log2_;		//!< block_size frames of computed gain
 };
 
 template<class In> 
@@ -115,6 +415,18 @@ public:
 		return x * gain;
 	}
 
+	/*!
+	 * @brief Process a block of samples with branchless kernel. When Sample is float and Functor is one of
+	 * the curves from soft_clip.h, SSE2 or AVX2 kernel is selected at runtime.
+	 * @param in n input samples.
+	 * @param out n output samples, may point to the same buffer as in.
+	 * @param n number of samples to process.
+	 */
+	void process(const Sample* in, Sample* out, size_t n)
+	{
+		detail::limiter_block<Sample, Functor>::process(in, out, n, threshold_, swing_, functor_);
+	}
+
 private:
 	Functor functor_;
 	Sample threshold_;
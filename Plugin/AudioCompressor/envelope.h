@@ -0,0 +1,209 @@
+/*!
+ * @file dsp++/envelope.h
+ * @brief Recursive (IIR) envelope followers.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_ENVELOPE_H_INCLUDED
+#define DSP_ENVELOPE_H_INCLUDED
+
+#include "config.h"
+#include "trivial_array.h"
+#include "algorithm.h"
+#include "fastmath.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace dsp {
+
+/*!
+ * @brief Calculate coefficient of one-pole lowpass smoothing filter @f$y_n = a y_{n-1} + (1 - a) x_n@f$
+ * with given time constant.
+ * @param L time constant in samples (time it takes the step response to reach @f$1 - 1/e@f$), 0 means
+ * no smoothing at all.
+ * @return pole location a.
+ */
+template<class Sample>
+inline Sample one_pole_coefficient(Sample L)
+{
+	using std::exp;
+	return (L > Sample() ? exp(Sample(-1) / L) : Sample());
+}
+
+/*!
+ * @brief Smoothed-square RMS detector built from Poles cascaded one-pole lowpass filters.
+ * Drop-in (Envelope) replacement for quadratic_mean with O(1) state per channel - there is no buffer
+ * and no circular index.
+ * @tparam Sample type of sample this algorithm works with.
+ * @tparam Poles number of cascaded one-pole sections (1 or 2 are the usual choices), each section
+ * has a time constant of L / Poles, so that the overall integration time stays comparable.
+ */
+template<class Sample, unsigned Poles = 1>
+class rms_follower: public sample_based_transform<Sample>
+{
+public:
+	/*!
+	 * @param L integration time constant in samples.
+	 * @param ic initial condition (RMS value) the state is initialized to.
+	 * @param channels number of independent channels processed with process_frame().
+	 */
+	explicit rms_follower(size_t L, Sample ic = Sample(), size_t channels = 1)
+	 :	state_(channels * Poles, ic * ic)
+	 ,	channels_(channels)
+	{
+		set_period(L);
+	}
+
+	//! @pre channels() == 1
+	Sample operator()(Sample x)
+	{
+		Sample mean;
+		process_frame(&x, &mean);
+		return mean;
+	}
+
+	/*!
+	 * @brief Calculate RMS value of next frame of channels() samples.
+	 * @param x frame of channels() subsequent samples.
+	 * @param mean frame of channels() RMS values.
+	 */
+	void process_frame(const Sample* x, Sample* mean)
+	{
+		using std::sqrt;
+		const size_t C = channels_;
+		Sample* s = state_.get();
+		for (size_t c = 0; c < C; ++c)
+			s[c] = flush_denormal(a_ * s[c] + b_ * x[c] * x[c]);	// decays exponentially in silence
+		for (unsigned p = 1; p < Poles; ++p, s += C)
+			for (size_t c = 0; c < C; ++c)
+				s[C + c] = flush_denormal(a_ * s[C + c] + b_ * s[c]);
+		for (size_t c = 0; c < C; ++c)
+			mean[c] = sqrt(s[c]);
+	}
+
+	size_t channels() const {return channels_;}
+	size_t period() const {return L_;}
+	//! @brief There's no buffer, so any period may be set.
+	size_t capacity() const {return static_cast<size_t>(-1);}
+	//! @brief There's no buffer, so this is a no-op provided for compatibility with generalized_mean.
+	void reserve(size_t) {}
+
+	//! @param L integration time constant in samples.
+	void set_period(size_t L)
+	{
+		L_ = L;
+		a_ = one_pole_coefficient(static_cast<Sample>(L) / Poles);
+		b_ = 1 - a_;
+	}
+
+private:
+	trivial_array<Sample> state_;	//!< mean square of each channel for each section (section-major)
+	size_t channels_;
+	size_t L_;
+	Sample a_;
+	Sample b_;
+};
+
+/*!
+ * @brief Attack/release topology of peak_follower.
+ */
+enum follower_mode {
+	/*!
+	 * @brief Attack or release coefficient is chosen depending on whether the input is above or below
+	 * current state (branching).
+	 */
+	follower_branching,
+	/*!
+	 * @brief Release is applied to a peak-hold state first and attack smooths its output (decoupled),
+	 * which gives smoother release curve when attack time is nonzero.
+	 */
+	follower_decoupled,
+};
+
+/*!
+ * @brief Peak envelope follower with separate attack and release times.
+ * Drop-in (Envelope) replacement for generalized_mean with O(1) state per channel.
+ * @tparam Sample type of sample this algorithm works with.
+ * @tparam Mode one of follower_mode values.
+ */
+template<class Sample, follower_mode Mode = follower_branching>
+class peak_follower: public sample_based_transform<Sample>
+{
+public:
+	/*!
+	 * @param L release time constant in samples, attack is instantaneous until set_attack() is called.
+	 * @param ic initial condition (peak value) the state is initialized to.
+	 * @param channels number of independent channels processed with process_frame().
+	 */
+	explicit peak_follower(size_t L, Sample ic = Sample(), size_t channels = 1)
+	 :	state_(channels * 2, ic)
+	 ,	channels_(channels)
+	 ,	attack_()
+	{
+		set_period(L);
+	}
+
+	//! @pre channels() == 1
+	Sample operator()(Sample x)
+	{
+		Sample peak;
+		process_frame(&x, &peak);
+		return peak;
+	}
+
+	/*!
+	 * @brief Calculate peak envelope of next frame of channels() samples.
+	 * @param x frame of channels() subsequent samples.
+	 * @param peak frame of channels() envelope values.
+	 */
+	void process_frame(const Sample* x, Sample* peak)
+	{
+		using std::abs;
+		const size_t C = channels_;
+		Sample* y = state_.get();
+		if (follower_branching == Mode)
+			for (size_t c = 0; c < C; ++c)
+			{
+				const Sample a = static_cast<Sample>(abs(x[c]));
+				const Sample k = (a > y[c] ? attack_ : release_);
+				peak[c] = y[c] = flush_denormal(k * y[c] + (1 - k) * a);	// release decays exponentially in silence
+			}
+		else
+		{
+			Sample* h = y + C;	// release (peak-hold) stage
+			for (size_t c = 0; c < C; ++c)
+			{
+				const Sample a = static_cast<Sample>(abs(x[c]));
+				// (1 - attack_) * h[c] goes denormal before h[c] does, hence flush_tiny()
+				h[c] = std::max(a, flush_tiny(release_ * h[c] + (1 - release_) * a));
+				peak[c] = y[c] = flush_tiny(attack_ * y[c] + (1 - attack_) * h[c]);
+			}
+		}
+	}
+
+	size_t channels() const {return channels_;}
+	size_t period() const {return L_;}
+	//! @brief There's no buffer, so any period may be set.
+	size_t capacity() const {return static_cast<size_t>(-1);}
+	//! @brief There's no buffer, so this is a no-op provided for compatibility with generalized_mean.
+	void reserve(size_t) {}
+
+	//! @param L release time constant in samples.
+	void set_period(size_t L) {L_ = L; set_release(static_cast<Sample>(L));}
+
+	//! @param L attack time constant in samples, 0 means instantaneous attack.
+	void set_attack(Sample L) {attack_ = one_pole_coefficient(L);}
+	//! @param L release time constant in samples.
+	void set_release(Sample L) {release_ = one_pole_coefficient(L);}
+
+private:
+	trivial_array<Sample> state_;	//!< envelope of each channel followed by peak-hold state (decoupled mode only)
+	size_t channels_;
+	size_t L_;
+	Sample attack_;
+	Sample release_;
+};
+
+}
+
+#endif /* DSP_ENVELOPE_H_INCLUDED */
@@ -0,0 +1,134 @@
+/*!
+ * @file dsp++/fastmath.h
+ * @brief Fast polynomial approximations of transcendental functions used in log-domain processing.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_FASTMATH_H_INCLUDED
+#define DSP_FASTMATH_H_INCLUDED
+
+#include "config.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace dsp {
+
+/*!
+ * @brief Accuracy tiers of the approximated log2()/exp2() functions. The error bound of each tier is
+ * specified as the maximum error of a gain value computed as exp2(a * log2(x)) with |a| <= 1, expressed in dB.
+ */
+enum math_accuracy {
+	accuracy_exact,		//!< use std::log2()/std::exp2().
+	accuracy_0_01dB,	//!< 4th order polynomials, error below 0.01 dB.
+	accuracy_0_1dB,		//!< 3rd order polynomials, error below 0.1 dB.
+};
+
+//! @brief Conversion factor from log2 domain to dB, @f$20\log_{10}2@f$.
+const float log2_to_dB = 6.0205999f;
+//! @brief Conversion factor from dB to log2 domain, @f$1/(20\log_{10}2)@f$.
+const float dB_to_log2 = 0.1660964f;
+
+namespace detail {
+
+inline unsigned float_bits(float x) {unsigned u; std::memcpy(&u, &x, sizeof(u)); return u;}
+inline float bits_float(unsigned u) {float x; std::memcpy(&x, &u, sizeof(x)); return x;}
+
+}
+
+/*!
+ * @brief Approximate binary logarithm.
+ * The argument is split into exponent and mantissa @f$m\in[1,2)@f$; @f$\log_2 m@f$ is approximated with
+ * a polynomial @f$t + t(1-t)q(t)@f$, @f$t = m - 1@f$, which is exact at octave boundaries so that the
+ * result is continuous and monotonic.
+ * @param x argument, values below std::numeric_limits<float>::min() (including zero and denormals) are
+ * clamped to it.
+ * @tparam Accuracy one of math_accuracy values.
+ */
+template<math_accuracy Accuracy>
+inline float fast_log2(float x)
+{
+	if (!(x > std::numeric_limits<float>::min()))
+		x = std::numeric_limits<float>::min();
+	if (accuracy_exact == Accuracy)
+		return std::log2(x);
+
+	const unsigned u = detail::float_bits(x);
+	const float e = static_cast<float>(static_cast<int>(u >> 23) - 127);
+	const float t = detail::bits_float((u & 0x007fffffu) | 0x3f800000u) - 1.f;
+	float q;
+	if (accuracy_0_01dB == Accuracy)
+		q = 0.42286532f - 0.15922010f * t;
+	else
+		q = 0.34655525f;
+	return e + t + t * (1.f - t) * q;
+}
+
+/*!
+ * @brief Approximate base-2 exponential, the inverse of fast_log2().
+ * The fractional part @f$f\in[0,1)@f$ is approximated with a polynomial @f$1 + f + f(f-1)q(f)@f$,
+ * the integer part is inserted directly into the exponent bits.
+ * @param x argument, clamped to [-126, 127] so that the result is always a finite, normal number.
+ * @tparam Accuracy one of math_accuracy values.
+ */
+template<math_accuracy Accuracy>
+inline float fast_exp2(float x)
+{
+	if (x < -126.f)
+		x = -126.f;
+	else if (x > 127.f)
+		x = 127.f;
+	if (accuracy_exact == Accuracy)
+		return std::exp2(x);
+
+	int i = static_cast<int>(x);
+	i -= (x < static_cast<float>(i));	// floor() for negative values
+	const float f = x - static_cast<float>(i);
+	float q;
+	if (accuracy_0_01dB == Accuracy)
+		q = 0.30410988f + 0.07924493f * f;
+	else
+		q = 0.34428665f;
+	const float m = 1.f + f + f * (f - 1.f) * q;
+	return m * detail::bits_float(static_cast<unsigned>(i + 127) << 23);
+}
+
+/*!
+ * @brief Replace a denormal (subnormal) value with zero. Recursive state (filter memories, running
+ * sums, smoothed gains) decays into the denormal range when the input goes silent, and arithmetic on
+ * denormals is one to two orders of magnitude slower on most CPUs unless the FPU flushes them itself.
+ * Branchless, so it vectorizes when applied to arrays; types other than float and double pass through.
+ */
+inline float flush_denormal(float x) {return (std::abs(x) < std::numeric_limits<float>::min() ? 0.f : x);}
+inline double flush_denormal(double x) {return (std::abs(x) < std::numeric_limits<double>::min() ? 0. : x);}
+template<class Sample>
+inline Sample flush_denormal(Sample x) {return x;}
+
+/*!
+ * @brief Like flush_denormal(), with the threshold raised by the mantissa width (about 1e-31, -620 dB
+ * for float). For recursive state which is multiplied by small coefficients or subtracted from a close
+ * value: such products and differences go denormal while the state itself is still a normal number.
+ */
+inline float flush_tiny(float x)
+{
+	return (std::abs(x) < std::numeric_limits<float>::min() / std::numeric_limits<float>::epsilon() ? 0.f : x);
+}
+inline double flush_tiny(double x)
+{
+	return (std::abs(x) < std::numeric_limits<double>::min() / std::numeric_limits<double>::epsilon() ? 0. : x);
+}
+template<class Sample>
+inline Sample flush_tiny(Sample x) {return x;}
+
+//! @brief Replace denormal values of n-element array with zeros, see flush_denormal().
+template<class Sample>
+inline void flush_denormals(Sample* x, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		x[i] = flush_denormal(x[i]);
+}
+
+}
+
+#endif /* DSP_FASTMATH_H_INCLUDED */
@@ -0,0 +1,292 @@
+/*!
+ * @file dsp++/lookahead.h
+ * @brief Look-ahead brickwall limiter with true-peak detection.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_LOOKAHEAD_H_INCLUDED
+#define DSP_LOOKAHEAD_H_INCLUDED
+
+#include "config.h"
+#include "trivial_array.h"
+#include "envelope.h"
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace dsp {
+
+/*!
+ * @brief Sliding-window minimum over the last W values, O(1) amortized per value.
+ * Implemented with monotonic deque held in a circular buffer preallocated for the maximum window length.
+ */
+template<class Sample>
+class sliding_minimum {
+public:
+	explicit sliding_minimum(size_t max_W = 1)
+	 :	value_(std::max(max_W, static_cast<size_t>(1)))
+	 ,	time_(value_.size())
+	{
+		set_window(1);
+	}
+
+	//! @brief Reallocate for windows up to max_W values long and reset, not for real-time context.
+	void reserve(size_t max_W)
+	{
+		max_W = std::max(max_W, static_cast<size_t>(1));
+		trivial_array<Sample> value(max_W);
+		trivial_array<size_t> time(max_W);
+		value_.swap(value);
+		time_.swap(time);
+		set_window(std::min(W_, max_W));
+	}
+
+	//! @brief Set window length (clamped to capacity) and reset.
+	void set_window(size_t W)
+	{
+		W_ = std::max(std::min(W, value_.size()), static_cast<size_t>(1));
+		front_ = size_ = 0;
+		t_ = 0;
+	}
+
+	size_t window() const {return W_;}
+
+	//! @brief Push next value and return minimum of the last window() values.
+	Sample operator()(Sample x)
+	{
+		const size_t cap = value_.size();
+		while (0 != size_ && !(value_[back()] < x))	// values not smaller than x will never be minimum again
+			--size_;
+		if (0 != size_ && time_[front_] + W_ <= t_)	// front left the window
+		{
+			if (++front_ == cap)
+				front_ = 0;
+			--size_;
+		}
+		++size_;
+		value_[back()] = x;
+		time_[back()] = t_++;
+		return value_[front_];
+	}
+
+private:
+	size_t back() const
+	{
+		size_t b = front_ + size_ - 1;
+		return (b >= value_.size() ? b - value_.size() : b);
+	}
+
+	trivial_array<Sample> value_;	//!< deque of increasing values
+	trivial_array<size_t> time_;	//!< time index of each value in deque
+	size_t W_;
+	size_t front_;
+	size_t size_;
+	size_t t_;
+};
+
+/*!
+ * @brief Look-ahead brickwall limiter with 4x oversampled true-peak detection and linked gain.
+ * The required gain (ceiling / peak) goes through a sliding minimum and a moving average, both W samples
+ * long, and the signal is delayed accordingly, which guarantees that the gain has fully reached the
+ * required value when the peak arrives, without any overshoot.
+ * @tparam Sample type of processed samples.
+ */
+template<class Sample>
+class lookahead_limiter {
+public:
+	/*!
+	 * @brief Number of input samples on each side of the interpolated point used by true-peak detector
+	 * (12 taps per phase at 4x oversampling, the same as the interpolator in ITU-R BS.1770).
+	 */
+	enum {interpolator_half_length = 6, oversampling = 4};
+
+	/*!
+	 * @param channels number of processed channels.
+	 * @param max_lookahead maximum look-ahead in samples, see reserve().
+	 */
+	explicit lookahead_limiter(size_t channels, size_t max_lookahead = 0)
+	 :	channels_(channels)
+	 ,	history_(channels * 4 * interpolator_half_length)
+	 ,	previous_peak_(channels)
+	 ,	delay_(channels)
+	 ,	average_(1)
+	 ,	lookahead_(0)
+	 ,	ceiling_(1)
+	 ,	release_(0)
+	{
+		init_interpolator();
+		reserve(max_lookahead);
+	}
+
+	/*!
+	 * @brief Preallocate buffers for look-ahead of up to max_lookahead samples and reset the state.
+	 * This is the only operation (apart from construction) which allocates memory.
+	 */
+	void reserve(size_t max_lookahead)
+	{
+		const size_t W = max_lookahead + 1;
+		trivial_array<Sample> delay(channels_ * (W + interpolator_half_length));
+		trivial_array<double> average(W);
+		delay_.swap(delay);
+		average_.swap(average);
+		minimum_.reserve(W);
+		set_lookahead(std::min(lookahead_, max_lookahead));
+	}
+
+	/*!
+	 * @brief Set look-ahead time and reset the state; changes latency(), so it should be done only
+	 * when the host can be notified about it.
+	 * @param samples look-ahead in samples, clamped to capacity set with reserve().
+	 */
+	void set_lookahead(size_t samples)
+	{
+		lookahead_ = std::min(samples, average_.size() - 1);
+		minimum_.set_window(lookahead_ + 1);
+		reset();
+	}
+
+	size_t lookahead() const {return lookahead_;}
+
+	//! @return total delay introduced by the limiter (look-ahead and true-peak interpolator).
+	size_t latency() const {return lookahead_ + interpolator_half_length;}
+
+	Sample ceiling_dB() const {using std::log10; return Sample(20) * log10(ceiling_);}
+	void set_ceiling_dB(Sample c) {using std::pow; ceiling_ = pow(Sample(10), c/20);}
+	Sample ceiling() const {return ceiling_;}
+	void set_ceiling(Sample c) {ceiling_ = c;}
+
+	//! @param samples release time constant in samples.
+	void set_release(Sample samples) {release_ = one_pole_coefficient(samples);}
+
+	//! @brief Clear delay lines and gain state.
+	void reset()
+	{
+		std::fill(history_.begin(), history_.end(), Sample());
+		std::fill(previous_peak_.begin(), previous_peak_.end(), Sample());
+		std::fill(delay_.begin(), delay_.end(), Sample());
+		std::fill(average_.begin(), average_.end(), 1.);
+		for (size_t i = 0; i <= lookahead_; ++i)
+			minimum_(Sample(1));
+		sum_ = static_cast<double>(lookahead_ + 1);
+		gain_ = 1;
+		history_pos_ = 0;
+		delay_pos_ = 0;
+		average_pos_ = 0;
+	}
+
+	/*!
+	 * @brief Process a block of planar channels; the output is delayed by latency() samples.
+	 * @param in channels arrays of n input samples.
+	 * @param out channels arrays of n output samples, may point to the same buffers as in.
+	 * @param n number of samples to process.
+	 */
+	void process(const Sample* const* in, Sample* const* out, size_t n)
+	{
+		using std::abs;
+		const size_t C = channels_;
+		const size_t H = interpolator_half_length;
+		const size_t hlen = 2 * H;						// history length of each channel (stored twice)
+		const size_t W = lookahead_ + 1;
+		const size_t D = lookahead_ + H;				// delay line length of each channel
+		const double inv_W = 1. / W;
+		for (size_t i = 0; i < n; ++i)
+		{
+			Sample peak = Sample();
+			for (size_t c = 0; c < C; ++c)
+			{
+				const Sample x = in[c][i];
+				Sample* h = history_.get() + c * 2 * hlen;
+				h[history_pos_] = h[history_pos_ + hlen] = x;
+				const Sample* window = h + history_pos_ + 1;	// hlen most recent samples, oldest first
+				Sample p = Sample();
+				for (size_t k = 0; k < oversampling - 1; ++k)
+				{
+					Sample y = Sample();
+					for (size_t j = 0; j < hlen; ++j)
+						y += window[j] * coeffs_[k][j];
+					p = std::max(p, static_cast<Sample>(abs(y)));
+				}
+				// inter-sample peaks on both sides of the sample being checked
+				const Sample sample_peak = static_cast<Sample>(abs(window[H - 1]));
+				peak = std::max(peak, std::max(sample_peak, std::max(p, previous_peak_[c])));
+				previous_peak_[c] = p;
+
+				Sample* d = delay_.get() + c * D;
+				if (0 != D)
+				{
+					const Sample y = d[delay_pos_];
+					d[delay_pos_] = x;
+					out[c][i] = y;
+				}
+				else
+					out[c][i] = x;
+			}
+			if (++history_pos_ == hlen)
+				history_pos_ = 0;
+			if (++delay_pos_ >= D)
+				delay_pos_ = 0;
+
+			const Sample required = (peak > ceiling_ ? ceiling_ / peak : Sample(1));
+			const Sample hold = minimum_(required);
+			sum_ += hold - average_[average_pos_];
+			average_[average_pos_] = hold;
+			if (++average_pos_ == W)
+			{
+				average_pos_ = 0;
+				sum_ = 0;								// get rid of accumulated rounding error once per cycle
+				for (size_t k = 0; k < W; ++k)
+					sum_ += average_[k];
+			}
+			const Sample target = static_cast<Sample>(sum_ * inv_W);
+			gain_ = (target < gain_ ? target : gain_ + (1 - release_) * (target - gain_));
+
+			for (size_t c = 0; c < C; ++c)
+				out[c][i] *= gain_;
+		}
+	}
+
+private:
+	/*!
+	 * @brief Blackman-windowed sinc interpolator evaluated at fractional offsets k/4 (k = 1..3) from
+	 * the center sample, each phase normalized to unity DC gain.
+	 */
+	void init_interpolator()
+	{
+		const double pi = 3.14159265358979323846;
+		const int H = interpolator_half_length;
+		for (int k = 1; k < oversampling; ++k)
+		{
+			double sum = 0;
+			double c[2 * interpolator_half_length];
+			for (int j = 0; j < 2 * H; ++j)
+			{
+				const double u = (j - (H - 1)) - static_cast<double>(k) / oversampling;	// distance from interpolated point
+				const double sinc = std::sin(pi * u) / (pi * u);
+				const double w = 0.42 + 0.5 * std::cos(pi * u / H) + 0.08 * std::cos(2 * pi * u / H);
+				sum += c[j] = sinc * w;
+			}
+			for (int j = 0; j < 2 * H; ++j)
+				coeffs_[k - 1][j] = static_cast<Sample>(c[j] / sum);
+		}
+	}
+
+	const size_t channels_;
+	Sample coeffs_[oversampling - 1][2 * interpolator_half_length];
+	trivial_array<Sample> history_;			//!< recent input samples of each channel, stored twice for contiguous reads
+	trivial_array<Sample> previous_peak_;	//!< inter-sample peak preceding the checked sample of each channel
+	trivial_array<Sample> delay_;			//!< signal delay line of each channel
+	trivial_array<double> average_;			//!< moving average buffer of held gain values
+	sliding_minimum<Sample> minimum_;
+	size_t lookahead_;
+	Sample ceiling_;
+	Sample release_;
+	Sample gain_;
+	double sum_;
+	size_t history_pos_;
+	size_t delay_pos_;
+	size_t average_pos_;
+};
+
+}
+
+#endif /* DSP_LOOKAHEAD_H_INCLUDED */
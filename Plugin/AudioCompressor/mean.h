@@ -10,12 +10,32 @@
 #include "config.h"
 #include "trivial_array.h"
 #include "algorithm.h"
+#include "fastmath.h"
 
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
 
 namespace dsp {
 
+namespace detail {
+
+//! @return smallest power of 2 not less than n (and not less than 1).
+inline size_t ceil_pow2(size_t n)
+{
+	size_t p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+}
+
+/*!
+ * @brief Power and root of generalized_mean with the order given at run time, which decides between
+ * log()/exp() (order 0) and pow() on every call. When the order is known at compile time use
+ * fixed_order_mean (or one of the named means), which has no such branch.
+ */
 template<class Sample, class Exponent>
 struct generalized_mean_functor {
 	Exponent exponent;
@@ -53,47 +73,209 @@ public:
 	 * @param p mean exponent; notable values: 0 - geometric mean, -1 - harmonic mean, 2 - quadratic mean (RMS).
 	 * @param ic initial condition the preceding samples and "step back" mean value are initialized to. Important
 	 * when Sample is a real type and working with non-greater-than-zero values.
+	 * @param channels number of independent channels averaged in parallel with process_frame().
 	 */
-	generalized_mean(size_t L, Exponent p, Sample ic = Sample())
+	generalized_mean(size_t L, Exponent p, Sample ic = Sample(), size_t channels = 1)
 	 :	functor_(p)
-	 ,	buffer_(L, (functor_.power(ic)) / L)
-	 ,	pmean_(L * buffer_[0])
+	 ,	buffer_(detail::ceil_pow2(L) * channels, functor_.power(ic))
+	 ,	pmean_(channels)
+	 ,	shadow_(channels)
+	 ,	ic_(ic)
      , 	L_(L)
+     , 	mask_(detail::ceil_pow2(L) - 1)
  	 , 	n_(0)
 	{
+		reset_period(L);
 	}
 
-	generalized_mean(size_t L, const Functor& f, Sample ic = Sample())
+	generalized_mean(size_t L, const Functor& f, Sample ic = Sample(), size_t channels = 1)
 	 :	functor_(f)
-	 ,	buffer_(L, (functor_.power(ic)) / L)
-	 ,	pmean_(L * buffer_[0])
+	 ,	buffer_(detail::ceil_pow2(L) * channels, functor_.power(ic))
+	 ,	pmean_(channels)
+	 ,	shadow_(channels)
+	 ,	ic_(ic)
      , 	L_(L)
+     , 	mask_(detail::ceil_pow2(L) - 1)
  	 , 	n_(0)
 	{
+		reset_period(L);
 	}
 
 	/*!
 	 * @brief Move the averaging window to next sample and calculate the mean value.
 	 * @param x next (subsequent) sample.
 	 * @return mean value of x and (L - 1) previous samples.
+	 * @pre channels() == 1
 	 */
 	Sample operator()(Sample x)
 	{
-		Sample p = functor_.power(x) / L_;
-		pmean_ -= buffer_[n_];	// subtract oldest intermediate value from previous step result
-		pmean_ += p;			// add current intermediate value
-		buffer_[n_] = p;		// and store it in circular buffer so that it can be subtracted when we advance by L_ samples
-		++n_;					// move circular buffer to next index
-		n_ %= L_;
-		return functor_.root(pmean_); // return the appropriate root of the intermediate sum
+		Sample mean;
+		process_frame(&x, &mean);
+		return mean;
+	}
+
+	/*!
+	 * @brief Move the averaging window of each channel to next sample and calculate the mean values.
+	 * The state is kept as structure-of-arrays (the circular buffer stores all channels of a sample
+	 * contiguously and the circular index is shared), so the loop over channels is vectorizable.
+	 * @param x frame of channels() subsequent samples.
+	 * @param mean frame of channels() mean values.
+	 */
+	void process_frame(const Sample* x, Sample* mean)
+	{
+		const size_t C = pmean_.size();
+		Sample* head = buffer_.get() + (n_ & mask_) * C;
+		const Sample* tail = buffer_.get() + ((n_ - L_) & mask_) * C;
+		for (size_t c = 0; c < C; ++c)
+		{
+			Sample p = flush_denormal(functor_.power(x[c]));	// squares of a fading signal are the first to go denormal
+			pmean_[c] -= tail[c];	// subtract value leaving the averaging window from previous step result
+			pmean_[c] += p;			// add current intermediate value
+			shadow_[c] += p;		// and to the shadow sum, which is only ever added to
+			head[c] = p;			// and store it in circular buffer so that it can be subtracted when we advance by L_ samples
+			mean[c] = functor_.root(pmean_[c] * inv_L_); // return the appropriate root of the intermediate mean
+		}
+		++n_;						// move circular buffer to next index
+		if (++shadowed_ == L_)		// shadow sum covers the whole window now, so it replaces the running sum
+			swap_in_shadow();		// with its rounding error
+	}
+
+	//! @return number of channels averaged in parallel.
+	size_t channels() const {return pmean_.size();}
+
+	//! @return averaging period.
+	size_t period() const {return L_;}
+
+	//! @return maximum averaging period which may be set without reallocating the buffer (power of 2).
+	size_t capacity() const {return mask_ + 1;}
+
+	/*!
+	 * @brief Change averaging period without reallocating the buffer, the window is simply extended
+	 * into (or shrunk from) the history held in the circular buffer. The running sum is updated with the
+	 * samples entering or leaving the window only (or summed from scratch when the window shrinks to fewer
+	 * samples than it loses), so this takes O(|L - period()|) time, which is little when the period is
+	 * automated smoothly.
+	 * @param L new averaging period, clamped to [1, capacity()].
+	 */
+	void set_period(size_t L)
+	{
+		L = std::max(std::min(L, capacity()), static_cast<size_t>(1));
+		if (L > L_)
+			accumulate_window<false>(pmean_.get(), n_ - L, L - L_);
+		else if (L_ - L < L)
+		{
+			accumulate_window<true>(pmean_.get(), n_ - L_, L_ - L);
+			flush_denormals(pmean_.get(), pmean_.size());
+		}
+		else					// cheaper to sum the remaining samples, into the shadow sum which is swapped in below
+		{
+			std::fill_n(shadow_.get(), shadow_.size(), Sample());
+			accumulate_window<false>(shadow_.get(), n_ - L, L);
+			shadowed_ = L;
+		}
+		L_ = L;
+		inv_L_ = Sample(1) / static_cast<Sample>(L_);
+		if (shadowed_ >= L_)	// shadow sum covers the window (or more), drop its oldest samples and swap it in
+		{
+			accumulate_window<true>(shadow_.get(), n_ - shadowed_, shadowed_ - L_);
+			swap_in_shadow();
+		}
+	}
+
+	/*!
+	 * @brief Reallocate the buffer so that the period may be changed up to max_L with set_period().
+	 * The latest samples are kept (as many as fit in both buffers), older ones are the initial condition,
+	 * so the buffer may be grown in between processed blocks without disturbing the mean. This is the
+	 * only operation (apart from construction) which allocates memory, so it should not be called from
+	 * real-time context.
+	 * @param max_L requested capacity, rounded up to power of 2; if smaller than current period,
+	 * the period is clamped.
+	 */
+	void reserve(size_t max_L)
+	{
+		const size_t C = pmean_.size();
+		const size_t capacity = detail::ceil_pow2(max_L);
+		trivial_array<Sample, Allocator> buffer(capacity * C, functor_.power(ic_));
+		const size_t kept = std::min(capacity, this->capacity());
+		for (size_t n = n_ - kept; n != n_; ++n)	// running index wraps around, masking it doesn't care
+		{
+			const Sample* frame = buffer_.get() + (n & mask_) * C;
+			std::copy(frame, frame + C, buffer.get() + (n & (capacity - 1)) * C);
+		}
+		buffer_.swap(buffer);
+		mask_ = capacity - 1;
+		if (L_ > capacity)		// the window lost its oldest samples
+			reset_period(L_);
 	}
 
 private:
+	/*!
+	 * @brief Set the period and calculate the running sum from scratch, in O(L) time; used only where
+	 * the buffer is (re)initialized.
+	 */
+	void reset_period(size_t L)
+	{
+		const size_t C = pmean_.size();
+		L_ = std::max(std::min(L, capacity()), static_cast<size_t>(1));
+		inv_L_ = Sample(1) / static_cast<Sample>(L_);
+		std::fill_n(pmean_.get(), C, Sample());
+		accumulate_window<false>(pmean_.get(), n_ - L_, L_);
+		std::fill_n(shadow_.get(), C, Sample());
+		shadowed_ = 0;
+	}
+
+	/*!
+	 * @brief Replace the running sum with the shadow sum and start a new one. The running sum is updated
+	 * by adding and subtracting values, so it accumulates rounding error which otherwise grows without
+	 * bound in long streams. The shadow sum only adds the values entering the window, so once it has
+	 * seen L_ of them it is the sum of the window from scratch, computed at O(1) cost per sample instead
+	 * of in one O(L) pass. A denormal residue left by the subtractions after the input goes silent is
+	 * dropped with the running sum.
+	 */
+	void swap_in_shadow()
+	{
+		const size_t C = pmean_.size();
+		for (size_t c = 0; c < C; ++c)
+		{
+			pmean_[c] = flush_denormal(shadow_[c]);
+			shadow_[c] = Sample();
+		}
+		shadowed_ = 0;
+	}
+
+	/*!
+	 * @brief Add (or subtract) the intermediate values of frames [n, n + count) of the running index to
+	 * (or from) sum. The frames are at most 2 contiguous spans of the buffer, so there's no per-element
+	 * index masking.
+	 */
+	template<bool Subtract>
+	void accumulate_window(Sample* sum, size_t n, size_t count)
+	{
+		const size_t start = n & mask_;
+		const size_t first = std::min(count, mask_ + 1 - start);
+		accumulate<Subtract>(sum, buffer_.get() + start * pmean_.size(), first);
+		accumulate<Subtract>(sum, buffer_.get(), count - first);
+	}
+
+	template<bool Subtract>
+	void accumulate(Sample* sum, const Sample* p, size_t count)
+	{
+		const size_t C = pmean_.size();
+		for (size_t i = 0; i < count * C; i += C)
+			for (size_t c = 0; c < C; ++c)
+				sum[c] = (Subtract ? sum[c] - p[i + c] : sum[c] + p[i + c]);
+	}
+
 	Functor functor_;
-	trivial_array<Sample, Allocator> buffer_;	//!< L_-length (circular) buffer holding intermediate values (averaged powers or logs if p_ == 0)
-	Sample pmean_;					//!< previous step mean value
-	const size_t L_;				//!< averaging period and buffer_ length
-	size_t n_;						//!< index of current sample in the circular buffer
+	trivial_array<Sample, Allocator> buffer_;	//!< (mask_ + 1)-length (circular) buffer of channels-sized frames holding intermediate values (powers or logs if p_ == 0)
+	trivial_array<Sample, Allocator> pmean_;	//!< sum of intermediate values over averaging window of each channel
+	trivial_array<Sample, Allocator> shadow_;	//!< sum of intermediate values of the last shadowed_ samples of each channel
+	const Sample ic_;				//!< initial condition
+	size_t L_;						//!< averaging period
+	size_t mask_;					//!< buffer_ length (in frames, power of 2) minus 1, masks running index into circular buffer index
+	size_t n_;						//!< running index of current sample, masked with mask_ to get index in the circular buffer
+	size_t shadowed_;				//!< number of samples summed into shadow_, swapped in when it reaches L_
+	Sample inv_L_;					//!< 1 / L_
 };
 
 
@@ -113,7 +295,7 @@ class arithmetic_mean: public generalized_mean<Sample, int, arithmetic_mean_func
 {
 	typedef generalized_mean<Sample, int, arithmetic_mean_functor<Sample> > base;
 public:
-	arithmetic_mean(size_t L, Sample ic = Sample()): base(L, 1, ic) {}
+	arithmetic_mean(size_t L, Sample ic = Sample(), size_t channels = 1): base(L, 1, ic, channels) {}
 };
 
 
@@ -133,7 +315,7 @@ class geometric_mean: public generalized_mean<Sample, int, geometric_mean_functo
 {
 	typedef generalized_mean<Sample, int, geometric_mean_functor<Sample> > base;
 public:
-	geometric_mean(size_t L, Sample ic = Sample(1)): base(L, 0, ic) {}
+	geometric_mean(size_t L, Sample ic = Sample(1), size_t channels = 1): base(L, 0, ic, channels) {}
 };
 
 template<class Sample>
@@ -152,7 +334,7 @@ class harmonic_mean: public generalized_mean<Sample, int, harmonic_mean_functor<
 {
 	typedef generalized_mean<Sample, int, harmonic_mean_functor<Sample> > base;
 public:
-	harmonic_mean(size_t L, Sample ic = Sample(1)): base(L, -1, ic) {}
+	harmonic_mean(size_t L, Sample ic = Sample(1), size_t channels = 1): base(L, -1, ic, channels) {}
 };
 
 
@@ -161,7 +343,7 @@ struct quadratic_mean_functor {
 	template<class Exponent>
 	quadratic_mean_functor(Exponent) {}
 	Sample power(Sample s) {return s * s;}
-	Sample root(Sample s) {using std::sqrt; return sqrt(s);}
+	Sample root(Sample s) {using std::sqrt; return sqrt(std::max(s, Sample()));}	// don't let rounding error produce NaN
 };
 /*!
  * @brief A special case: generalized mean of order 2, RMS value.
@@ -171,7 +353,77 @@ class quadratic_mean: public generalized_mean<Sample, int, quadratic_mean_functo
 {
 	typedef generalized_mean<Sample, int, quadratic_mean_functor<Sample> > base;
 public:
-	quadratic_mean(size_t L, Sample ic = Sample()): base(L, 2, ic) {}
+	quadratic_mean(size_t L, Sample ic = Sample(), size_t channels = 1): base(L, 2, ic, channels) {}
+};
+
+namespace detail {
+
+//! @brief x^P for integer P known at compile time, by squaring unrolled at compile time.
+template<class Sample, int P, bool Negative = (P < 0)>
+struct fixed_power {
+	static Sample power(Sample x)
+	{
+		const Sample h = fixed_power<Sample, P / 2>::power(x);
+		return (0 != P % 2 ? h * h * x : h * h);
+	}
+};
+template<class Sample, int P>
+struct fixed_power<Sample, P, true> {
+	static Sample power(Sample x) {return 1 / fixed_power<Sample, -P>::power(x);}
+};
+template<class Sample>
+struct fixed_power<Sample, 0, false> {
+	static Sample power(Sample) {return Sample(1);}
+};
+template<class Sample>
+struct fixed_power<Sample, 1, false> {
+	static Sample power(Sample x) {return x;}
+};
+
+}
+
+/*!
+ * @brief Power and root of generalized mean of order P fixed at compile time; orders 0, 1, 2 and -1
+ * use the functors of the named means, other ones integer power by multiplication and pow() for root.
+ */
+template<class Sample, int P>
+struct fixed_order_functor {
+	template<class Exponent>
+	fixed_order_functor(Exponent) {}
+	Sample power(Sample s) {return detail::fixed_power<Sample, P>::power(s);}
+	Sample root(Sample s) {using std::pow; return pow(s, Sample(1) / P);}
+};
+template<class Sample>
+struct fixed_order_functor<Sample, 0>: geometric_mean_functor<Sample> {
+	template<class Exponent>
+	fixed_order_functor(Exponent e): geometric_mean_functor<Sample>(e) {}
+};
+template<class Sample>
+struct fixed_order_functor<Sample, 1>: arithmetic_mean_functor<Sample> {
+	template<class Exponent>
+	fixed_order_functor(Exponent e): arithmetic_mean_functor<Sample>(e) {}
+};
+template<class Sample>
+struct fixed_order_functor<Sample, 2>: quadratic_mean_functor<Sample> {
+	template<class Exponent>
+	fixed_order_functor(Exponent e): quadratic_mean_functor<Sample>(e) {}
+};
+template<class Sample>
+struct fixed_order_functor<Sample, -1>: harmonic_mean_functor<Sample> {
+	template<class Exponent>
+	fixed_order_functor(Exponent e): harmonic_mean_functor<Sample>(e) {}
+};
+
+/*!
+ * @brief Generalized mean of order P known at compile time, without the run-time order check of
+ * generalized_mean_functor in the per-sample loop.
+ */
+template<class Sample, int P, class Allocator = std::allocator<Sample> >
+class fixed_order_mean: public generalized_mean<Sample, int, fixed_order_functor<Sample, P>, Allocator>
+{
+	typedef generalized_mean<Sample, int, fixed_order_functor<Sample, P>, Allocator> base;
+public:
+	fixed_order_mean(size_t L, Sample ic = Sample(P > 0 ? 0 : 1), size_t channels = 1): base(L, P, ic, channels) {}
 };
 
 }
@@ -0,0 +1,300 @@
+/*!
+ * @file dsp++/oversampling.h
+ * @brief Power-of-two oversampling with cascaded polyphase half-band FIR filters.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_OVERSAMPLING_H_INCLUDED
+#define DSP_OVERSAMPLING_H_INCLUDED
+
+#include "config.h"
+#include "trivial_array.h"
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace dsp {
+
+namespace detail {
+
+//! @brief Modified Bessel function of the first kind, order 0 (power series), used by the Kaiser window.
+inline double bessel_i0(double x)
+{
+	double sum = 1, term = 1;
+	const double q = x * x / 4;
+	for (int k = 1; k < 50 && term > sum * 1e-17; ++k)
+	{
+		term *= q / (double(k) * k);
+		sum += term;
+	}
+	return sum;
+}
+
+/*!
+ * @brief Design the nonzero odd taps of a half-band lowpass of length 4K-1 (Kaiser-windowed sinc).
+ * Every other tap of a half-band filter is zero and the center one is 1/2; the remaining 2K taps,
+ * symmetric around the center, are normalized so that they sum to 1/2 (unity DC gain).
+ * @param g output array of 2K taps, g[p] is the tap 2p samples from the start of the impulse response.
+ */
+template<class Sample>
+void design_halfband(Sample* g, size_t K, double beta)
+{
+	const double pi = 3.14159265358979323846;
+	const double c = 2. * K - 1;				// center of the impulse response
+	const double i0_beta = bessel_i0(beta);
+	double sum = 0, h[64];
+	for (size_t p = 0; p < 2 * K; ++p)
+	{
+		const double u = 2. * p - c;			// odd distance from the center
+		const double r = u / (c + 1);
+		const double w = bessel_i0(beta * std::sqrt(std::max(0., 1 - r * r))) / i0_beta;
+		sum += h[p] = std::sin(pi * u / 2) / (pi * u) * w;
+	}
+	for (size_t p = 0; p < 2 * K; ++p)
+		g[p] = static_cast<Sample>(h[p] * 0.5 / sum);
+}
+
+}
+
+/*!
+ * @brief Single 2x stage of the oversampler: half-band interpolator and decimator of one channel.
+ * Only the 2K nonzero odd taps are convolved (polyphase form), at the lower of the two rates; the
+ * center tap is a plain delay. Delay lines are fixed-size members, so the stage never allocates.
+ * @tparam Sample type of processed samples.
+ * @tparam K number of nonzero taps on each side of the center, the filter is 4K-1 taps long.
+ */
+template<class Sample, size_t K>
+class halfband_stage {
+public:
+	enum {taps = 2 * K};
+	//! @brief Group delay of the interpolator (and of the decimator) in samples at the higher rate.
+	enum {latency = 2 * K - 1};
+
+	void reset()
+	{
+		std::fill(up_, up_ + 2 * taps, Sample());
+		std::fill(even_, even_ + 2 * taps, Sample());
+		std::fill(odd_, odd_ + 2 * K, Sample());
+		up_pos_ = even_pos_ = odd_pos_ = 0;
+	}
+
+	/*!
+	 * @brief Interpolate n samples into 2n.
+	 * @param g 2K taps designed with detail::design_halfband().
+	 */
+	void upsample(const Sample* g, const Sample* in, Sample* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			up_[up_pos_] = up_[up_pos_ + taps] = in[i];
+			if (++up_pos_ == taps)
+				up_pos_ = 0;
+			const Sample* x = up_ + up_pos_;	// taps most recent inputs, oldest first
+			Sample y = Sample();
+			for (size_t p = 0; p < K; ++p)			// taps are symmetric
+				y += g[p] * (x[p] + x[taps - 1 - p]);
+			out[2 * i] = 2 * y;
+			out[2 * i + 1] = x[K];				// center tap: input delayed by K - 1 samples
+		}
+	}
+
+	/*!
+	 * @brief Decimate 2n samples into n.
+	 * @param g 2K taps designed with detail::design_halfband().
+	 */
+	void downsample(const Sample* g, const Sample* in, Sample* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			even_[even_pos_] = even_[even_pos_ + taps] = in[2 * i];
+			if (++even_pos_ == taps)
+				even_pos_ = 0;
+			const Sample* x = even_ + even_pos_;
+			Sample y = Sample();
+			for (size_t p = 0; p < K; ++p)			// taps are symmetric
+				y += g[p] * (x[p] + x[taps - 1 - p]);
+			// center tap: odd sample 2K - 1 samples back, i.e. the one of the pair K periods ago
+			out[i] = y + odd_[odd_pos_] / 2;
+			odd_[odd_pos_] = in[2 * i + 1];
+			if (++odd_pos_ == K)
+				odd_pos_ = 0;
+		}
+	}
+
+private:
+	Sample up_[2 * taps];		//!< interpolator inputs, stored twice for contiguous reads
+	Sample even_[2 * taps];		//!< decimator even inputs, stored twice
+	Sample odd_[2 * K];			//!< decimator odd inputs delayed by K pairs
+	size_t up_pos_;
+	size_t even_pos_;
+	size_t odd_pos_;
+};
+
+/*!
+ * @brief Oversampling by 1, 2, 4 or 8 with a cascade of polyphase half-band stages, for running
+ * nonlinear processing at a higher rate. The first stage has the steepest filter (47 taps, flat
+ * passband up to 0.3 of the base rate, about 80 dB stopband); later ones only reject images above
+ * the already filtered band, so they are progressively shorter.
+ * A short delay at the oversampled rate rounds the latency up to a whole number of base-rate samples,
+ * so that it can be compensated exactly by the host. All buffers are allocated by the constructor for
+ * blocks of up to max_block base-rate samples.
+ * @tparam Sample type of processed samples.
+ */
+template<class Sample>
+class oversampler {
+public:
+	enum {max_stages = 3, max_factor = 1 << max_stages};
+
+	/*!
+	 * @param channels number of independent channels.
+	 * @param max_block maximum number of base-rate samples passed to upsample()/downsample().
+	 */
+	oversampler(size_t channels, size_t max_block)
+	 :	stage1_(channels)
+	 ,	stage2_(channels)
+	 ,	stage3_(channels)
+	 ,	tail_(channels * max_factor)
+	 ,	scratch_(max_block * (6 + max_factor))
+	 ,	max_block_(max_block)
+	 ,	stages_(0)
+	 ,	latency_(0)
+	 ,	delay_(0)
+	{
+		detail::design_halfband(g1_, K1, 8.);
+		detail::design_halfband(g2_, K2, 7.);
+		detail::design_halfband(g3_, K3, 6.);
+		reset();
+	}
+
+	size_t channels() const {return stage1_.size();}
+	size_t max_block() const {return max_block_;}
+	size_t factor() const {return static_cast<size_t>(1) << stages_;}
+
+	/*!
+	 * @brief Set oversampling factor and reset the state; changes latency(), so it should be done only
+	 * when the host can be notified about it.
+	 * @param f 1, 2, 4 or 8, other values are rounded down to one of them.
+	 */
+	void set_factor(size_t f)
+	{
+		stages_ = 0;
+		while (stages_ < max_stages && (static_cast<size_t>(2) << stages_) <= f)
+			++stages_;
+		// each stage delays by its group delay twice, at its higher rate; the sum in oversampled samples
+		// is padded to a whole number of base-rate samples with the compensation delay
+		const size_t F = factor();
+		size_t d = 0;
+		if (stages_ > 0) d += 2 * halfband_stage<Sample, K1>::latency * (F / 2);
+		if (stages_ > 1) d += 2 * halfband_stage<Sample, K2>::latency * (F / 4);
+		if (stages_ > 2) d += 2 * halfband_stage<Sample, K3>::latency * (F / 8);
+		latency_ = (d + F - 1) / F;
+		delay_ = latency_ * F - d;
+		reset();
+	}
+
+	//! @return delay of downsample(upsample(x)) in base-rate samples, exact (no fractional part).
+	size_t latency() const {return latency_;}
+
+	void reset()
+	{
+		for (size_t c = 0; c < stage1_.size(); ++c)
+		{
+			stage1_[c].reset();
+			stage2_[c].reset();
+			stage3_[c].reset();
+		}
+		std::fill(tail_.begin(), tail_.end(), Sample());
+	}
+
+	/*!
+	 * @brief Upsample one channel.
+	 * @param in n input samples, n <= max_block().
+	 * @param out n * factor() output samples, must not overlap in.
+	 */
+	void upsample(const Sample* in, Sample* out, size_t n, size_t channel)
+	{
+		Sample* const half = scratch_.get();							// 2n samples
+		Sample* const quarter = scratch_.get() + 2 * max_block_;	// 4n samples
+		switch (stages_)
+		{
+		case 0:
+			std::copy(in, in + n, out);
+			break;
+		case 1:
+			stage1_[channel].upsample(g1_, in, out, n);
+			break;
+		case 2:
+			stage1_[channel].upsample(g1_, in, half, n);
+			stage2_[channel].upsample(g2_, half, out, 2 * n);
+			break;
+		default:
+			stage1_[channel].upsample(g1_, in, half, n);
+			stage2_[channel].upsample(g2_, half, quarter, 2 * n);
+			stage3_[channel].upsample(g3_, quarter, out, 4 * n);
+			break;
+		}
+	}
+
+	/*!
+	 * @brief Downsample one channel.
+	 * @param in n * factor() input samples, n <= max_block().
+	 * @param out n output samples, must not overlap in.
+	 */
+	void downsample(const Sample* in, Sample* out, size_t n, size_t channel)
+	{
+		in = compensate(in, n * factor(), channel);
+		Sample* const half = scratch_.get();
+		Sample* const quarter = scratch_.get() + 2 * max_block_;
+		switch (stages_)
+		{
+		case 0:
+			std::copy(in, in + n, out);
+			break;
+		case 1:
+			stage1_[channel].downsample(g1_, in, out, n);
+			break;
+		case 2:
+			stage2_[channel].downsample(g2_, in, half, 2 * n);
+			stage1_[channel].downsample(g1_, half, out, n);
+			break;
+		default:
+			stage3_[channel].downsample(g3_, in, quarter, 4 * n);
+			stage2_[channel].downsample(g2_, quarter, half, 2 * n);
+			stage1_[channel].downsample(g1_, half, out, n);
+			break;
+		}
+	}
+
+private:
+	enum {K1 = 12, K2 = 6, K3 = 4};
+
+	//! @return m oversampled samples delayed by delay_ (< factor()), in scratch_ unless there's no delay.
+	const Sample* compensate(const Sample* in, size_t m, size_t channel)
+	{
+		if (0 == delay_ || 0 == m)
+			return in;
+		Sample* const d = scratch_.get() + 6 * max_block_;
+		Sample* const t = tail_.get() + channel * max_factor;
+		std::copy(t, t + delay_, d);
+		std::copy(in, in + m - delay_, d + delay_);
+		std::copy(in + m - delay_, in + m, t);
+		return d;
+	}
+
+	Sample g1_[2 * K1];
+	Sample g2_[2 * K2];
+	Sample g3_[2 * K3];
+	trivial_array<halfband_stage<Sample, K1> > stage1_;		//!< base <-> 2x of each channel
+	trivial_array<halfband_stage<Sample, K2> > stage2_;		//!< 2x <-> 4x
+	trivial_array<halfband_stage<Sample, K3> > stage3_;		//!< 4x <-> 8x
+	trivial_array<Sample> tail_;		//!< last delay_ oversampled samples of each channel
+	trivial_array<Sample> scratch_;		//!< 2, 4 and max_factor blocks at intermediate rates / compensated
+	size_t max_block_;
+	size_t stages_;
+	size_t latency_;
+	size_t delay_;					//!< compensation delay in oversampled samples
+};
+
+}
+
+#endif /* DSP_OVERSAMPLING_H_INCLUDED */
@@ -46,7 +46,9 @@
 instrument determined by PLUG _IS _INST
 */
 
-#define PLUG_CHANNEL_IO "1-1 2-2"
+#define PLUG_CHANNEL_IO "1-1 2-2 4-2"
+// inputs 3-4 are the stereo sidechain (aux bus in VST3)
+#define PLUG_SC_CHANS 2
 
 #define PLUG_LATENCY 0
 #define PLUG_IS_INST 0
@@ -70,6 +72,12 @@ instrument determined by PLUG _IS _INST
 #define GUI_WIDTH 330
 #define GUI_HEIGHT 170
 
+// Integer editor scale, e.g. -DGUI_SCALE=2 for a HiDPI build: the layout above is multiplied and the
+// bitmaps are scaled once when loaded, through the scaled bitmap cache shared by all instances.
+#ifndef GUI_SCALE
+#define GUI_SCALE 1
+#endif
+
 // on MSVC, you must define SA_API in the resource editor preprocessor macros as well as the c++ ones
 #if defined(SA_API)
 #include "app_wrapper/app_resource.h"
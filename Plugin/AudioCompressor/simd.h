@@ -0,0 +1,97 @@
+/*!
+ * @file dsp++/simd.h
+ * @brief Runtime detection of SIMD instruction sets and helper macros for writing ISA-specific kernels.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_SIMD_H_INCLUDED
+#define DSP_SIMD_H_INCLUDED
+
+#include "config.h"
+
+#ifndef DSP_SIMD_DISABLED
+//! @brief Set to 1 to disable SIMD kernels and runtime ISA dispatch entirely (scalar code is used then).
+#define DSP_SIMD_DISABLED 0
+#endif // DSP_SIMD_DISABLED
+
+#if !DSP_SIMD_DISABLED && (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+//! @brief Defined to 1 when x86 SSE2/AVX2 kernels are compiled in.
+#define DSP_SIMD_X86 1
+#else
+#define DSP_SIMD_X86 0
+#endif
+
+#if DSP_SIMD_X86
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+//! @brief Marks a function as using SSE2 instructions, so that it may be compiled without -msse2 (32-bit targets).
+#define DSP_TARGET_SSE2 __attribute__((target("sse2")))
+//! @brief Marks a function as using AVX2 instructions, so that it may be compiled without -mavx2.
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DSP_TARGET_SSE2
+#define DSP_TARGET_AVX2
+#endif
+
+#endif // DSP_SIMD_X86
+
+namespace dsp { namespace simd {
+
+//! @brief Instruction sets kernels are specialized for, in increasing order of preference.
+enum isa {
+	isa_scalar,
+	isa_sse2,
+	isa_avx2,
+};
+
+namespace detail {
+
+inline isa detect_isa()
+{
+#if DSP_SIMD_X86
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+	__cpuid(info, 1);
+	const bool sse2 = (0 != (info[3] & (1 << 26)));
+	const bool osxsave = (0 != (info[2] & (1 << 27)));
+	const bool avx = (0 != (info[2] & (1 << 28)));
+	bool avx2 = false;
+	if (max_leaf >= 7 && osxsave && avx && (6 == (_xgetbv(0) & 6)))	// OS saves YMM state
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (0 != (info[1] & (1 << 5)));
+	}
+	if (avx2)
+		return isa_avx2;
+	return (sse2 ? isa_sse2 : isa_scalar);
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return isa_avx2;
+	return (__builtin_cpu_supports("sse2") ? isa_sse2 : isa_scalar);
+#endif
+#else
+	return isa_scalar;
+#endif
+}
+
+}
+
+/*!
+ * @brief Best instruction set supported by the CPU this code runs on. Detection is done once, on first call.
+ */
+inline isa best_isa()
+{
+	static const isa best = detail::detect_isa();
+	return best;
+}
+
+} }
+
+#endif /* DSP_SIMD_H_INCLUDED */
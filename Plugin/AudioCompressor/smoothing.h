@@ -0,0 +1,86 @@
+/*!
+ * @file dsp++/smoothing.h
+ * @brief Parameter smoothing (de-zippering) helpers.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_SMOOTHING_H_INCLUDED
+#define DSP_SMOOTHING_H_INCLUDED
+
+#include "config.h"
+#include "envelope.h"
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace dsp {
+
+/*!
+ * @brief Parameter value which follows its target with a one-pole lowpass, one step per sample.
+ * Once the remaining distance drops below the snap threshold the value jumps to the target, so that
+ * a settled parameter is exactly equal to it and the caller may skip per-sample work with settled().
+ * @tparam Sample type of the smoothed value.
+ */
+template<class Sample>
+class smoothed_value {
+public:
+	/*!
+	 * @param value initial value (and target).
+	 * @param L smoothing time constant in samples, 0 means no smoothing.
+	 * @param snap distance to target below which the value jumps to it.
+	 */
+	explicit smoothed_value(Sample value = Sample(), Sample L = Sample(), Sample snap = Sample(1e-5))
+	 :	value_(value)
+	 ,	target_(value)
+	 ,	snap_(snap)
+	{
+		set_time_constant(L);
+	}
+
+	//! @param L smoothing time constant in samples, 0 means no smoothing.
+	void set_time_constant(Sample L) {a_ = one_pole_coefficient(L);}
+
+	Sample target() const {return target_;}
+	void set_target(Sample t) {target_ = t;}
+
+	Sample value() const {return value_;}
+	bool settled() const {return value_ == target_;}
+	//! @brief Jump to the target immediately, e.g. after reset or on the first parameter update.
+	void settle() {value_ = target_;}
+
+	//! @return value of the next sample.
+	Sample operator()()
+	{
+		using std::abs;
+		if (value_ != target_)
+		{
+			value_ = target_ + a_ * (value_ - target_);
+			if (!(abs(value_ - target_) > snap_))
+				value_ = target_;
+		}
+		return value_;
+	}
+
+	/*!
+	 * @brief Write values of the next n samples.
+	 * @param out array of n values.
+	 * @param n number of samples.
+	 */
+	void fill(Sample* out, size_t n)
+	{
+		size_t i = 0;
+		for (; i < n && !settled(); ++i)
+			out[i] = (*this)();
+		std::fill(out + i, out + n, value_);
+	}
+
+private:
+	Sample value_;
+	Sample target_;
+	Sample a_;
+	Sample snap_;
+};
+
+}
+
+#endif /* DSP_SMOOTHING_H_INCLUDED */
@@ -0,0 +1,234 @@
+/*!
+ * @file dsp++/soft_clip.h
+ * @brief Soft-clipping curves for dsp::limiter together with vectorized block kernels.
+ * @author Andrzej Ciarkowski <mailto:andrzej.ciarkowski@gmail.com>
+ */
+#ifndef DSP_SOFT_CLIP_H_INCLUDED
+#define DSP_SOFT_CLIP_H_INCLUDED
+
+#include "config.h"
+#include "algorithm.h"
+#include "simd.h"
+
+#include <cstddef>
+#include <algorithm>
+
+namespace dsp {
+
+/*!
+ * @brief Rational approximation of tanh() (Lambert's continued fraction truncated to 7/6 order),
+ * maximum error is below 1e-4 and the output saturates exactly at +-1.
+ */
+template<class Sample>
+struct fast_tanh: public sample_based_transform<Sample> {
+	Sample operator()(Sample x) const
+	{
+		x = std::max(std::min(x, Sample(5)), Sample(-5));
+		const Sample x2 = x * x;
+		const Sample y = x * (Sample(135135) + x2 * (Sample(17325) + x2 * (Sample(378) + x2)))
+				/ (Sample(135135) + x2 * (Sample(62370) + x2 * (Sample(3150) + x2 * Sample(28))));
+		return std::max(std::min(y, Sample(1)), Sample(-1));
+	}
+};
+
+/*!
+ * @brief Cubic soft-clipping curve @f$x - \frac{4}{27}x^3@f$, which has unity slope at 0 (so it joins
+ * linear region of the limiter smoothly) and reaches 1 with zero slope at x = 1.5.
+ */
+template<class Sample>
+struct cubic_clip: public sample_based_transform<Sample> {
+	Sample operator()(Sample x) const
+	{
+		x = std::max(std::min(x, Sample(1.5)), Sample(-1.5));
+		return x - Sample(4./27.) * x * x * x;
+	}
+};
+
+/*!
+ * @brief Quintic soft-clipping curve @f$x - \frac{x^5}{5k^4}@f$, k = 1.25, which has unity slope at 0 and
+ * reaches 1 with zero slope at x = k; it stays closer to linear than cubic_clip and has sharper knee.
+ */
+template<class Sample>
+struct quintic_clip: public sample_based_transform<Sample> {
+	Sample operator()(Sample x) const
+	{
+		x = std::max(std::min(x, Sample(1.25)), Sample(-1.25));
+		const Sample x2 = x * x;
+		return x - Sample(0.08192) * x2 * x2 * x;
+	}
+};
+
+namespace detail {
+
+/*!
+ * @brief Branchless limiter gain formula shared by scalar and vector kernels: for a = |x| below threshold
+ * the clipping curve gets 0 and the gain is t / t = 1, so there's no need to test each sample.
+ */
+template<class Sample, class Functor>
+inline void limiter_scalar(const Sample* in, Sample* out, size_t n, Sample threshold, Sample swing, Functor& f)
+{
+	using std::abs;
+	const Sample inv_swing = (swing > Sample() ? Sample(1) / swing : Sample());
+	for (size_t i = 0; i < n; ++i)
+	{
+		const Sample a = static_cast<Sample>(abs(in[i]));
+		const Sample y = f(std::max(a - threshold, Sample()) * inv_swing);
+		out[i] = in[i] * (threshold + y * swing) / std::max(a, threshold);
+	}
+}
+
+//! @brief Vector implementations of clipping curves; not available for generic Functor.
+template<class Functor>
+struct soft_clip_simd {enum {available = 0};};
+
+#if DSP_SIMD_X86
+
+template<>
+struct soft_clip_simd<fast_tanh<float> > {
+	enum {available = 1};
+
+	DSP_TARGET_SSE2 static __m128 sse2(__m128 x)
+	{
+		x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-5.f)), _mm_set1_ps(5.f));
+		const __m128 x2 = _mm_mul_ps(x, x);
+		__m128 num = _mm_add_ps(_mm_set1_ps(378.f), x2);
+		num = _mm_add_ps(_mm_set1_ps(17325.f), _mm_mul_ps(x2, num));
+		num = _mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(135135.f), _mm_mul_ps(x2, num)));
+		__m128 den = _mm_add_ps(_mm_set1_ps(3150.f), _mm_mul_ps(x2, _mm_set1_ps(28.f)));
+		den = _mm_add_ps(_mm_set1_ps(62370.f), _mm_mul_ps(x2, den));
+		den = _mm_add_ps(_mm_set1_ps(135135.f), _mm_mul_ps(x2, den));
+		return _mm_min_ps(_mm_max_ps(_mm_div_ps(num, den), _mm_set1_ps(-1.f)), _mm_set1_ps(1.f));
+	}
+
+	DSP_TARGET_AVX2 static __m256 avx2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-5.f)), _mm256_set1_ps(5.f));
+		const __m256 x2 = _mm256_mul_ps(x, x);
+		__m256 num = _mm256_add_ps(_mm256_set1_ps(378.f), x2);
+		num = _mm256_add_ps(_mm256_set1_ps(17325.f), _mm256_mul_ps(x2, num));
+		num = _mm256_mul_ps(x, _mm256_add_ps(_mm256_set1_ps(135135.f), _mm256_mul_ps(x2, num)));
+		__m256 den = _mm256_add_ps(_mm256_set1_ps(3150.f), _mm256_mul_ps(x2, _mm256_set1_ps(28.f)));
+		den = _mm256_add_ps(_mm256_set1_ps(62370.f), _mm256_mul_ps(x2, den));
+		den = _mm256_add_ps(_mm256_set1_ps(135135.f), _mm256_mul_ps(x2, den));
+		return _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(num, den), _mm256_set1_ps(-1.f)), _mm256_set1_ps(1.f));
+	}
+};
+
+template<>
+struct soft_clip_simd<cubic_clip<float> > {
+	enum {available = 1};
+
+	DSP_TARGET_SSE2 static __m128 sse2(__m128 x)
+	{
+		x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.5f)), _mm_set1_ps(1.5f));
+		const __m128 x3 = _mm_mul_ps(_mm_mul_ps(x, x), x);
+		return _mm_sub_ps(x, _mm_mul_ps(_mm_set1_ps(4.f/27.f), x3));
+	}
+
+	DSP_TARGET_AVX2 static __m256 avx2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-1.5f)), _mm256_set1_ps(1.5f));
+		const __m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+		return _mm256_sub_ps(x, _mm256_mul_ps(_mm256_set1_ps(4.f/27.f), x3));
+	}
+};
+
+template<>
+struct soft_clip_simd<quintic_clip<float> > {
+	enum {available = 1};
+
+	DSP_TARGET_SSE2 static __m128 sse2(__m128 x)
+	{
+		x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.25f)), _mm_set1_ps(1.25f));
+		const __m128 x2 = _mm_mul_ps(x, x);
+		const __m128 x5 = _mm_mul_ps(_mm_mul_ps(x2, x2), x);
+		return _mm_sub_ps(x, _mm_mul_ps(_mm_set1_ps(0.08192f), x5));
+	}
+
+	DSP_TARGET_AVX2 static __m256 avx2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-1.25f)), _mm256_set1_ps(1.25f));
+		const __m256 x2 = _mm256_mul_ps(x, x);
+		const __m256 x5 = _mm256_mul_ps(_mm256_mul_ps(x2, x2), x);
+		return _mm256_sub_ps(x, _mm256_mul_ps(_mm256_set1_ps(0.08192f), x5));
+	}
+};
+
+template<class Functor>
+DSP_TARGET_SSE2 inline size_t limiter_sse2(const float* in, float* out, size_t n, float threshold, float swing)
+{
+	const __m128 t = _mm_set1_ps(threshold);
+	const __m128 s = _mm_set1_ps(swing);
+	const __m128 inv_s = _mm_set1_ps(swing > 0.f ? 1.f / swing : 0.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(in + i);
+		const __m128 a = _mm_and_ps(x, abs_mask);
+		const __m128 y = soft_clip_simd<Functor>::sse2(_mm_mul_ps(_mm_max_ps(_mm_sub_ps(a, t), zero), inv_s));
+		const __m128 g = _mm_div_ps(_mm_add_ps(t, _mm_mul_ps(y, s)), _mm_max_ps(a, t));
+		_mm_storeu_ps(out + i, _mm_mul_ps(x, g));
+	}
+	return i;
+}
+
+template<class Functor>
+DSP_TARGET_AVX2 inline size_t limiter_avx2(const float* in, float* out, size_t n, float threshold, float swing)
+{
+	const __m256 t = _mm256_set1_ps(threshold);
+	const __m256 s = _mm256_set1_ps(swing);
+	const __m256 inv_s = _mm256_set1_ps(swing > 0.f ? 1.f / swing : 0.f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(in + i);
+		const __m256 a = _mm256_and_ps(x, abs_mask);
+		const __m256 y = soft_clip_simd<Functor>::avx2(_mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(a, t), zero), inv_s));
+		const __m256 g = _mm256_div_ps(_mm256_add_ps(t, _mm256_mul_ps(y, s)), _mm256_max_ps(a, t));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(x, g));
+	}
+	return i;
+}
+
+#endif // DSP_SIMD_X86
+
+/*!
+ * @brief Block limiter kernel dispatcher, picks the best vector kernel available for the Functor on
+ * the CPU we're running on and processes the tail (or everything, if there's no kernel) with scalar code.
+ */
+template<class Sample, class Functor, bool Vectorized = (0 != soft_clip_simd<Functor>::available)>
+struct limiter_block {
+	static void process(const Sample* in, Sample* out, size_t n, Sample threshold, Sample swing, Functor& f)
+	{
+		limiter_scalar(in, out, n, threshold, swing, f);
+	}
+};
+
+#if DSP_SIMD_X86
+
+template<class Functor>
+struct limiter_block<float, Functor, true> {
+	static void process(const float* in, float* out, size_t n, float threshold, float swing, Functor& f)
+	{
+		size_t done = 0;
+		switch (simd::best_isa())
+		{
+		case simd::isa_avx2: done = limiter_avx2<Functor>(in, out, n, threshold, swing); break;
+		case simd::isa_sse2: done = limiter_sse2<Functor>(in, out, n, threshold, swing); break;
+		default: break;
+		}
+		limiter_scalar(in + done, out + done, n - done, threshold, swing, f);
+	}
+};
+
+#endif // DSP_SIMD_X86
+
+}
+
+}
+
+#endif /* DSP_SOFT_CLIP_H_INCLUDED */
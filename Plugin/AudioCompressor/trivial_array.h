@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <cstddef>
+#include <algorithm>
 
 
 namespace dsp {
@@ -77,6 +78,15 @@ public:
     size_type size() const {return size_;}
     size_type length() const {return size_;}
 
+    //! @brief Exchange contents with other array, this is the way to "resize" it without copying elements.
+    void swap(trivial_array& other)
+    {
+    	std::swap(alloc_, other.alloc_);
+    	std::swap(arr_, other.arr_);
+    	std::swap(size_, other.size_);
+    	std::swap(init_, other.init_);
+    }
+
 private:
     allocator_type alloc_;
 	pointer	arr_;
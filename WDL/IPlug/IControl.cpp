@@ -768,3 +768,94 @@ bool IFileSelectorControl::IsDirty()
   }
   return false;
 }
+
+IMeterControl::IMeterControl(IPlugBase* pPlug, IRECT pR, IMeterQueue* pQueue, int nChannels,
+                             const IColor* pLevelColor, const IColor* pGRColor, const IColor* pBGColor,
+                             double rangeDB, double grRangeDB, double decayDBPerSec)
+  : IControl(pPlug, pR), mQueue(pQueue), mNChannels(BOUNDED(nChannels, 1, METER_MAX_CHANNELS)),
+    mLevelColor(*pLevelColor), mGRColor(*pGRColor), mBGColor(*pBGColor),
+    mRangeDB(rangeDB), mGRRangeDB(grRangeDB), mDecayDBPerSec(decayDBPerSec), mGRDB(0.)
+{
+  for (int c = 0; c < METER_MAX_CHANNELS; ++c)
+  {
+    mPeakDB[c] = mRMSDB[c] = -mRangeDB;
+  }
+  for (int i = 0; i < 2 * METER_MAX_CHANNELS + 1; ++i)
+  {
+    mDrawnY[i] = -1;
+  }
+}
+
+// Channel bars side by side, then the gain reduction bar, with 1 pixel gaps.
+IRECT IMeterControl::GetBarRECT(int bar)
+{
+  int n = mNChannels + 1;
+  int w = (mRECT.W() - (n - 1)) / n;
+  int l = mRECT.L + bar * (w + 1);
+  return IRECT(l, mRECT.T, l + w, mRECT.B);
+}
+
+int IMeterControl::LevelToY(double dB, const IRECT* pR)
+{
+  double v = BOUNDED((dB + mRangeDB) / mRangeDB, 0., 1.);
+  return pR->B - int(v * (double) pR->H() + 0.5);
+}
+
+bool IMeterControl::IsDirty()
+{
+  IMeterValues v;
+  double sampleRate = mPlug->GetSampleRate();
+  while (mQueue->Pop(&v))
+  {
+    double fall = (sampleRate > 0. ? mDecayDBPerSec * (double) v.mNFrames / sampleRate : mRangeDB);
+    for (int c = 0; c < mNChannels; ++c)
+    {
+      double peak = (v.mPeak[c] > 0.f ? AmpToDB(v.mPeak[c]) : -mRangeDB);
+      double rms = (v.mRMS[c] > 0.f ? AmpToDB(v.mRMS[c]) : -mRangeDB);
+      mPeakDB[c] = IPMAX(peak, IPMAX(mPeakDB[c] - fall, -mRangeDB));
+      mRMSDB[c] = IPMAX(rms, IPMAX(mRMSDB[c] - fall, -mRangeDB));
+    }
+    mGRDB = IPMAX((double) v.mGainReduction, IPMAX(mGRDB - fall, 0.));
+  }
+
+  for (int c = 0; c < mNChannels; ++c)
+  {
+    IRECT r = GetBarRECT(c);
+    int peakY = LevelToY(mPeakDB[c], &r), rmsY = LevelToY(mRMSDB[c], &r);
+    if (peakY != mDrawnY[2 * c] || rmsY != mDrawnY[2 * c + 1])
+    {
+      mDirty = true;
+    }
+  }
+  IRECT gr = GetBarRECT(mNChannels);
+  int grY = gr.T + int(BOUNDED(mGRDB / mGRRangeDB, 0., 1.) * (double) gr.H() + 0.5);
+  if (grY != mDrawnY[2 * METER_MAX_CHANNELS])
+  {
+    mDirty = true;
+  }
+  return mDirty;
+}
+
+bool IMeterControl::Draw(IGraphics* pGraphics)
+{
+  pGraphics->FillIRect(&mBGColor, &mRECT);
+  for (int c = 0; c < mNChannels; ++c)
+  {
+    IRECT r = GetBarRECT(c);
+    int peakY = LevelToY(mPeakDB[c], &r), rmsY = LevelToY(mRMSDB[c], &r);
+    IRECT bar(r.L, rmsY, r.R, r.B);
+    pGraphics->FillIRect(&mLevelColor, &bar);
+    if (peakY < r.B)
+    {
+      pGraphics->DrawHorizontalLine(&mLevelColor, peakY, r.L, r.R - 1);
+    }
+    mDrawnY[2 * c] = peakY;
+    mDrawnY[2 * c + 1] = rmsY;
+  }
+  IRECT gr = GetBarRECT(mNChannels);
+  int grY = gr.T + int(BOUNDED(mGRDB / mGRRangeDB, 0., 1.) * (double) gr.H() + 0.5);
+  IRECT bar(gr.L, gr.T, gr.R, grY);
+  pGraphics->FillIRect(&mGRColor, &bar);
+  mDrawnY[2 * METER_MAX_CHANNELS] = grY;
+  return true;
+}
@@ -3,6 +3,7 @@
 
 #include "IPlugBase.h"
 #include "IGraphics.h"
+#include "IMeterQueue.h"
 
 // A control is anything on the GUI, it could be a static bitmap, or
 // something that moves or changes.  The control could manipulate
@@ -484,4 +485,33 @@ protected:
   EFileSelectorState mState;
 };
 
+// Level and gain reduction meter fed by the audio thread through an IMeterQueue,
+// which is drained in IsDirty() on the GUI thread, so the meter never locks the
+// plug. Draws an RMS bar with a peak line for each channel and a gain reduction
+// bar growing down from the top. Displayed values fall at decayDBPerSec, timed by
+// the frame counts of the readings, so the ballistics don't depend on the frame rate.
+class IMeterControl : public IControl
+{
+public:
+  IMeterControl(IPlugBase* pPlug, IRECT pR, IMeterQueue* pQueue, int nChannels,
+                const IColor* pLevelColor = &COLOR_GREEN, const IColor* pGRColor = &COLOR_ORANGE,
+                const IColor* pBGColor = &COLOR_BLACK, double rangeDB = 60., double grRangeDB = 24.,
+                double decayDBPerSec = 20.);
+  ~IMeterControl() {}
+
+  bool Draw(IGraphics* pGraphics);
+  bool IsDirty();
+
+protected:
+  IRECT GetBarRECT(int bar);
+  int LevelToY(double dB, const IRECT* pR);
+
+  IMeterQueue* mQueue;
+  int mNChannels;
+  IColor mLevelColor, mGRColor, mBGColor;
+  double mRangeDB, mGRRangeDB, mDecayDBPerSec;
+  double mPeakDB[METER_MAX_CHANNELS], mRMSDB[METER_MAX_CHANNELS], mGRDB;
+  int mDrawnY[2 * METER_MAX_CHANNELS + 1];  // pixel positions drawn last, to skip redraws that change nothing
+};
+
 #endif
@@ -1,6 +1,10 @@
 #include "IGraphics.h"
 
-#define DEFAULT_FPS 25
+#define DEFAULT_FPS 60
+
+// Timer rate once nothing has changed for IDLE_HOLD_MS, see IGraphics::OnRefreshTimer().
+#define DEFAULT_IDLE_FPS 4
+#define IDLE_HOLD_MS 500
 
 // If not dirty for this many timer ticks, we call OnGUIIDle.
 // Only looked at if USE_IDLE_CALLS is defined.
@@ -71,6 +75,176 @@ public:
 
 static BitmapStorage s_bitmapCache;
 
+// Bitmaps resized by ScaleBitmap/LoadScaledIBitmap, shared by all IGraphics instances.
+// Each entry counts the references held by IGraphics instances; entries nobody uses are kept
+// for the next editor until the total exceeds the memory budget, then dropped least recently used first.
+class ScaledBitmapStorage
+{
+public:
+
+  struct ScaledKey
+  {
+    LICE_IBitmap* src; // 0 once the source has been released
+    int w, h, n;
+    bool horizontal;
+    LICE_IBitmap* bitmap;
+    int refs;
+    unsigned int lastUse;
+  };
+
+  WDL_PtrList<ScaledKey> m_bitmaps;
+  WDL_Mutex m_mutex;
+  int m_bytes, m_budget;
+  unsigned int m_clock;
+
+  ScaledBitmapStorage() : m_bytes(0), m_budget(DEFAULT_SCALED_BITMAP_BUDGET), m_clock(0) {}
+
+  static int Bytes(LICE_IBitmap* bitmap) { return bitmap->getWidth() * bitmap->getHeight() * sizeof(LICE_pixel); }
+
+  // Returns a new reference to src scaled to w x h, scaling it if it is not cached.
+  LICE_IBitmap* Acquire(LICE_IBitmap* src, int w, int h, int n, bool horizontal)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    int i, count = m_bitmaps.GetSize();
+    for (i = 0; i < count; ++i)
+    {
+      ScaledKey* key = m_bitmaps.Get(i);
+      if (key->src == src && key->w == w && key->h == h && key->n == n && key->horizontal == horizontal)
+      {
+        ++key->refs;
+        key->lastUse = ++m_clock;
+        return key->bitmap;
+      }
+    }
+    ScaledKey* key = m_bitmaps.Add(new ScaledKey);
+    key->src = src;
+    key->w = w;
+    key->h = h;
+    key->n = n;
+    key->horizontal = horizontal;
+    key->bitmap = ScaleFrames(src, w, h, n, horizontal);
+    key->refs = 1;
+    key->lastUse = ++m_clock;
+    m_bytes += Bytes(key->bitmap);
+    Trim();
+    return key->bitmap;
+  }
+
+  // Returns false if bitmap did not come from Acquire.
+  bool Release(LICE_IBitmap* bitmap)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    int i, n = m_bitmaps.GetSize();
+    for (i = 0; i < n; ++i)
+    {
+      ScaledKey* key = m_bitmaps.Get(i);
+      if (key->bitmap == bitmap)
+      {
+        if (key->refs > 0) --key->refs;
+        key->lastUse = ++m_clock;
+        Trim();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The source is about to be deleted, so its address may be reused by an unrelated bitmap.
+  void ForgetSource(LICE_IBitmap* src)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    int i, n = m_bitmaps.GetSize();
+    for (i = 0; i < n; ++i)
+    {
+      ScaledKey* key = m_bitmaps.Get(i);
+      if (key->src == src) key->src = 0;
+    }
+    Trim();
+  }
+
+  void SetBudget(int bytes)
+  {
+    WDL_MutexLock lock(&m_mutex);
+    m_budget = bytes;
+    Trim();
+  }
+
+  int GetBytes()
+  {
+    WDL_MutexLock lock(&m_mutex);
+    return m_bytes;
+  }
+
+  // Drop unused entries, oldest first, until the cache fits the budget.
+  // Unused entries whose source is gone can never be found again, so they go regardless.
+  void Trim()
+  {
+    for (;;)
+    {
+      int i, n = m_bitmaps.GetSize(), victim = -1;
+      for (i = 0; i < n; ++i)
+      {
+        ScaledKey* key = m_bitmaps.Get(i);
+        if (key->refs) continue;
+        if (!key->src) { victim = i; break; }
+        if (m_bytes > m_budget && (victim < 0 || key->lastUse < m_bitmaps.Get(victim)->lastUse)) victim = i;
+      }
+      if (victim < 0) break;
+      ScaledKey* key = m_bitmaps.Get(victim);
+      m_bytes -= Bytes(key->bitmap);
+      delete(key->bitmap);
+      m_bitmaps.Delete(victim, true);
+    }
+  }
+
+  // Scales each of the n frames separately, so that filtering never blends neighbouring frames.
+  static LICE_IBitmap* ScaleFrames(LICE_IBitmap* src, int w, int h, int n, bool horizontal)
+  {
+    LICE_MemBitmap* dest = new LICE_MemBitmap(w, h);
+    LICE_MemBitmap frame;
+    const int srcW = src->getWidth(), srcH = src->getHeight();
+    int i;
+    for (i = 0; i < n; ++i)
+    {
+      // frame boundaries as IGraphics::DrawBitmap computes them
+      int sx = 0, sy = 0, sw = srcW, sh = srcH, dx = 0, dy = 0, dw = w, dh = h;
+      if (horizontal)
+      {
+        sx = int(0.5 + (double) srcW * (double) i / (double) n);
+        sw = int(0.5 + (double) srcW * (double) (i + 1) / (double) n) - sx;
+        dx = int(0.5 + (double) w * (double) i / (double) n);
+        dw = int(0.5 + (double) w * (double) (i + 1) / (double) n) - dx;
+      }
+      else
+      {
+        sy = int(0.5 + (double) srcH * (double) i / (double) n);
+        sh = int(0.5 + (double) srcH * (double) (i + 1) / (double) n) - sy;
+        dy = int(0.5 + (double) h * (double) i / (double) n);
+        dh = int(0.5 + (double) h * (double) (i + 1) / (double) n) - dy;
+      }
+      if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) continue;
+
+      frame.resize(sw, sh);
+      _LICE::LICE_Blit(&frame, src, 0, 0, sx, sy, sw, sh, 1.0f, LICE_BLIT_MODE_COPY);
+      _LICE::LICE_ScaledBlit(dest, &frame, dx, dy, dw, dh, 0.0f, 0.0f, (float) sw, (float) sh, 1.0f,
+                             LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR);
+    }
+    return dest;
+  }
+
+  ~ScaledBitmapStorage()
+  {
+    int i, n = m_bitmaps.GetSize();
+    for (i = 0; i < n; ++i)
+    {
+      delete(m_bitmaps.Get(i)->bitmap);
+    }
+    m_bitmaps.Empty(true);
+  }
+};
+
+static ScaledBitmapStorage s_scaledBitmapCache;
+
 class FontStorage
 {
 public:
@@ -165,6 +339,10 @@ IGraphics::IGraphics(IPlugBase* pPlug, int w, int h, int refreshFPS)
   , mWidth(w)
   , mHeight(h)
   , mIdleTicks(0)
+  , mNDamageRects(0)
+  , mIdleFPS(DEFAULT_IDLE_FPS)
+  , mQuietTicks(0)
+  , mTimerMs(0)
   , mMouseCapture(-1)
   , mMouseOver(-1)
   , mMouseX(0)
@@ -192,6 +370,12 @@ IGraphics::~IGraphics()
   mControls.Empty(true);
   DELETE_NULL(mDrawBitmap);
   DELETE_NULL(mTmpBitmap);
+
+  int i, n = mScaledBitmaps.GetSize();
+  for (i = 0; i < n; ++i)
+  {
+    s_scaledBitmapCache.Release(mScaledBitmaps.Get(i));
+  }
 }
 
 void IGraphics::Resize(int w, int h)
@@ -208,6 +392,7 @@ void IGraphics::Resize(int w, int h)
 
 void IGraphics::SetFromStringAfterPrompt(IControl* pControl, IParam* pParam, char *txt)
 {
+  WakeRefreshTimer();
   if (pParam)
   {
     double v;
@@ -435,6 +620,29 @@ IBitmap IGraphics::LoadIBitmap(int ID, const char* name, int nStates, bool frame
   return IBitmap(lb, lb->getWidth(), lb->getHeight(), nStates, framesAreHoriztonal);
 }
 
+IBitmap IGraphics::LoadScaledIBitmap(int ID, const char* name, int nStates, double scale, bool framesAreHoriztonal)
+{
+  IBitmap bmp = LoadIBitmap(ID, name, nStates, framesAreHoriztonal);
+  int frameW = int(0.5 + scale * (double) bmp.frameWidth());
+  int frameH = int(0.5 + scale * (double) bmp.frameHeight());
+  if (frameW < 1) frameW = 1;
+  if (frameH < 1) frameH = 1;
+  int destW = framesAreHoriztonal ? frameW * nStates : frameW;
+  int destH = framesAreHoriztonal ? frameH : frameH * nStates;
+  if (destW == bmp.W && destH == bmp.H) return bmp;
+  return ScaleBitmap(&bmp, destW, destH);
+}
+
+void IGraphics::SetScaledBitmapBudget(int bytes)
+{
+  s_scaledBitmapCache.SetBudget(bytes);
+}
+
+int IGraphics::GetScaledBitmapBytes()
+{
+  return s_scaledBitmapCache.GetBytes();
+}
+
 void IGraphics::RetainBitmap(IBitmap* pBitmap)
 {
   s_bitmapCache.Add((LICE_IBitmap*)pBitmap->mData);
@@ -442,7 +650,16 @@ void IGraphics::RetainBitmap(IBitmap* pBitmap)
 
 void IGraphics::ReleaseBitmap(IBitmap* pBitmap)
 {
-  s_bitmapCache.Remove((LICE_IBitmap*)pBitmap->mData);
+  LICE_IBitmap* lb = (LICE_IBitmap*)pBitmap->mData;
+  int idx = mScaledBitmaps.Find(lb);
+  if (idx >= 0)
+  {
+    mScaledBitmaps.Delete(idx);
+    s_scaledBitmapCache.Release(lb);
+    return;
+  }
+  s_scaledBitmapCache.ForgetSource(lb);
+  s_bitmapCache.Remove(lb);
 }
 
 void IGraphics::PrepDraw()
@@ -632,13 +849,9 @@ bool IGraphics::DrawHorizontalLine(const IColor* pColor, int yi, int xLo, int xH
 IBitmap IGraphics::ScaleBitmap(IBitmap* pIBitmap, int destW, int destH)
 {
   LICE_IBitmap* pSrc = (LICE_IBitmap*) pIBitmap->mData;
-  LICE_MemBitmap* pDest = new LICE_MemBitmap(destW, destH);
-  _LICE::LICE_ScaledBlit(pDest, pSrc, 0, 0, destW, destH, 0.0f, 0.0f, (float) pIBitmap->W, (float) pIBitmap->H, 1.0f,
-                         LICE_BLIT_MODE_COPY | LICE_BLIT_FILTER_BILINEAR);
-
-  IBitmap bmp(pDest, destW, destH, pIBitmap->N);
-  RetainBitmap(&bmp);
-  return bmp;
+  LICE_IBitmap* pDest = s_scaledBitmapCache.Acquire(pSrc, destW, destH, pIBitmap->N, pIBitmap->mFramesAreHorizontal);
+  mScaledBitmaps.Add(pDest);
+  return IBitmap(pDest, destW, destH, pIBitmap->N, pIBitmap->mFramesAreHorizontal);
 }
 
 IBitmap IGraphics::CropBitmap(IBitmap* pIBitmap, IRECT* pR)
@@ -712,27 +925,35 @@ bool IGraphics::DrawRadialLine(const IColor* pColor, float cx, float cy, float a
   return DrawLine(pColor, xLo, yLo, xHi, yHi, pBlend, antiAlias);
 }
 
+static int RectArea(const IRECT& r)
+{
+  return r.W() * r.H();
+}
+
+// True if a and b share pixels (IRECT::Intersects also counts a touching right/bottom edge).
+static bool RectsOverlap(const IRECT& a, const IRECT& b)
+{
+  return a.L < b.R && b.L < a.R && a.T < b.B && b.T < a.B;
+}
+
 bool IGraphics::IsDirty(IRECT* pR)
 {
+  CollectDamage();
+
 #ifndef NDEBUG
   if (mShowControlBounds)
   {
     *pR = mDrawRECT;
+    mNDamageRects = 0;
+    AddDamage(*pR);
     return true;
   }
 #endif
-  
-  bool dirty = false;
-  int i, n = mControls.GetSize();
-  IControl** ppControl = mControls.GetList();
-  for (i = 0; i < n; ++i, ++ppControl)
+
+  bool dirty = (mNDamageRects > 0);
+  for (int i = 0; i < mNDamageRects; ++i)
   {
-    IControl* pControl = *ppControl;
-    if (pControl->IsDirty())
-    {
-      *pR = pR->Union(pControl->GetRECT());
-      dirty = true;
-    }
+    *pR = pR->Union(&mDamageRects[i]);
   }
 
 #ifdef USE_IDLE_CALLS
@@ -757,7 +978,7 @@ bool IGraphics::Draw(IRECT* pR)
 //  #pragma REMINDER("Mutex set while drawing")
 //  WDL_MutexLock lock(&mMutex);
 
-  int i, j, n = mControls.GetSize();
+  int j, n = mControls.GetSize();
   if (!n)
   {
     return true;
@@ -780,11 +1001,27 @@ bool IGraphics::Draw(IRECT* pR)
   }
   else
   {
-    IControl* pBG = mControls.Get(0);
-    if (pBG->IsDirty())   // Special case when everything needs to be drawn.
+    bool* pDamaged = mDamagedControls.Get();
+    int nDamaged = mDamagedControls.GetSize();
+    if (!mNDamageRects)
+    {
+      // Not a redraw the timer asked for (the window was uncovered, resized...). The OS area is
+      // redrawn from the controls' current state, and dirty controls stay dirty for the next tick.
+      mDrawRECT = *pR;
+      for (j = 0; j < n; ++j)
+      {
+        IControl* pControl2 = mControls.Get(j);
+        if ((!j || !pControl2->IsHidden()) && RectsOverlap(*(pControl2->GetRECT()), mDrawRECT))
+        {
+          pControl2->Draw(this);
+        }
+      }
+    }
+    else if (nDamaged && pDamaged[0])   // Special case when everything needs to be drawn.
     {
+      IControl* pBG = mControls.Get(0);
       mDrawRECT = *(pBG->GetRECT());
-      for (int j = 0; j < n; ++j)
+      for (j = 0; j < n; ++j)
       {
         IControl* pControl2 = mControls.Get(j);
         if (!j || !(pControl2->IsHidden()))
@@ -796,32 +1033,33 @@ bool IGraphics::Draw(IRECT* pR)
     }
     else
     {
-      for (i = 1; i < n; ++i)   // loop through all controls starting from one (not bg)
+      // Each damage rectangle collected at the last timer tick is redrawn once, bottom to top,
+      // clipped to it. The rectangles are disjoint, so no pixel is drawn twice by the same control.
+      // The damage is not collected again here: the OS only invalidated what the tick found.
+      int d;
+      for (d = 0; d < mNDamageRects; ++d)
       {
-        IControl* pControl = mControls.Get(i); // assign control i to pControl
-        if (pControl->IsDirty())   // if pControl is dirty
+        mDrawRECT = mDamageRects[d];
+        for (j = 0; j < n; ++j)
         {
-
-          // printf("control %i is Dirty\n", i);
-
-          mDrawRECT = *(pControl->GetRECT()); // put the rect in the mDrawRect member variable
-          for (j = 0; j < n; ++j)   // loop through all controls
+          IControl* pControl2 = mControls.Get(j);
+          if ((!j || !pControl2->IsHidden()) && RectsOverlap(*(pControl2->GetRECT()), mDrawRECT))
           {
-            IControl* pControl2 = mControls.Get(j); // assign control j to pControl2
-
-            // if control1 == control2 OR control2 is not hidden AND control2's rect intersects mDrawRect
-            if (!pControl2->IsHidden() && (i == j || pControl2->GetRECT()->Intersects(&mDrawRECT)))
-            {
-              //if ((i == j) && (!pControl2->IsHidden())|| (!(pControl2->IsHidden()) && pControl2->GetRECT()->Intersects(&mDrawRECT))) {
-              //printf("control %i and %i \n", i, j);
-
-              pControl2->Draw(this);
-            }
+            pControl2->Draw(this);
           }
-          pControl->SetClean();
+        }
+      }
+      // A control that got dirty since the tick may have been drawn, but not where the OS will
+      // show it, so it stays dirty for the next tick.
+      for (j = 0; j < n && j < nDamaged; ++j)
+      {
+        if (pDamaged[j])
+        {
+          mControls.Get(j)->SetClean();
         }
       }
     }
+    mNDamageRects = 0;
   }
 
 #ifndef NDEBUG
@@ -844,6 +1082,124 @@ bool IGraphics::Draw(IRECT* pR)
   return DrawScreen(pR);
 }
 
+// Rebuilds the damage rectangles from the controls that are dirty now.
+void IGraphics::CollectDamage()
+{
+  mNDamageRects = 0;
+  int i, n = mControls.GetSize();
+  bool* pDamaged = mDamagedControls.Resize(n, false);
+  IControl** ppControl = mControls.GetList();
+  for (i = 0; i < n; ++i, ++ppControl)
+  {
+    IControl* pControl = *ppControl;
+    pDamaged[i] = pControl->IsDirty();
+    if (pDamaged[i])
+    {
+      AddDamage(*(pControl->GetRECT()));
+    }
+  }
+}
+
+// Adds r to the damage, merging rectangles that overlap, or whose union costs no more pixels
+// than drawing both. When the set is full, r is merged with the rectangle that grows least.
+void IGraphics::AddDamage(IRECT r)
+{
+  if (r.Empty() || r.W() <= 0 || r.H() <= 0) return;
+
+  for (;;)
+  {
+    int i, merge = -1;
+    for (i = 0; i < mNDamageRects; ++i)
+    {
+      IRECT* pD = &mDamageRects[i];
+      if (RectsOverlap(*pD, r) || RectArea(pD->Union(&r)) <= RectArea(*pD) + RectArea(r))
+      {
+        merge = i;
+        break;
+      }
+    }
+    if (merge < 0 && mNDamageRects == MAX_DAMAGE_RECTS)
+    {
+      int growth = 0;
+      for (i = 0; i < mNDamageRects; ++i)
+      {
+        IRECT* pD = &mDamageRects[i];
+        int g = RectArea(pD->Union(&r)) - RectArea(*pD);
+        if (merge < 0 || g < growth)
+        {
+          merge = i;
+          growth = g;
+        }
+      }
+    }
+    if (merge < 0) break;
+
+    // the union may now touch other rectangles, so it is added again
+    r = r.Union(&mDamageRects[merge]);
+    mDamageRects[merge] = mDamageRects[--mNDamageRects];
+  }
+  mDamageRects[mNDamageRects++] = r;
+}
+
+int IGraphics::RefreshInterval()
+{
+  int holdTicks = IDLE_HOLD_MS * mFPS / 1000;
+  if (mIdleFPS <= 0 || mIdleFPS >= mFPS || mMouseCapture >= 0 || mQuietTicks < holdTicks)
+  {
+    return 1000 / mFPS;
+  }
+  return 1000 / mIdleFPS;
+}
+
+int IGraphics::StartRefreshTimer()
+{
+  mQuietTicks = 0;
+  mTimerMs = RefreshInterval();
+  return mTimerMs;
+}
+
+void IGraphics::UpdateRefreshTimer()
+{
+  int ms = RefreshInterval();
+  if (ms != mTimerMs)
+  {
+    mTimerMs = ms;
+    SetRefreshTimer(ms);
+  }
+}
+
+bool IGraphics::OnRefreshTimer(IRECT* pR)
+{
+  // host parameter changes queued by the API classes from the audio thread
+  int paramIdx;
+  double normalizedValue;
+  while (mPlug->PopGUIParamChange(&paramIdx, &normalizedValue))
+  {
+    SetParameterFromPlug(paramIdx, normalizedValue, true);
+  }
+  // and latency changes, which the host must hear about from this thread
+  mPlug->ReportPendingLatency();
+  mPlug->OnMainThreadIdle();
+
+  bool dirty = IsDirty(pR);
+  if (dirty)
+  {
+    mQuietTicks = 0;
+  }
+  else if (mQuietTicks <= IDLE_HOLD_MS * mFPS / 1000)
+  {
+    ++mQuietTicks;
+  }
+  UpdateRefreshTimer();
+  return dirty;
+}
+
+void IGraphics::WakeRefreshTimer()
+{
+  mQuietTicks = 0;
+  UpdateRefreshTimer();
+}
+
 void IGraphics::SetStrictDrawing(bool strict)
 {
   mStrict = strict;
@@ -852,6 +1208,7 @@ void IGraphics::SetStrictDrawing(bool strict)
 
 void IGraphics::OnMouseDown(int x, int y, IMouseMod* pMod)
 {
+  WakeRefreshTimer();
   ReleaseMouseCapture();
   int c = GetMouseControlIdx(x, y);
   if (c >= 0)
@@ -906,6 +1263,7 @@ void IGraphics::OnMouseDown(int x, int y, IMouseMod* pMod)
 
 void IGraphics::OnMouseUp(int x, int y, IMouseMod* pMod)
 {
+  WakeRefreshTimer();
   int c = GetMouseControlIdx(x, y);
   mMouseCapture = mMouseX = mMouseY = -1;
   if (c >= 0)
@@ -955,6 +1313,7 @@ void IGraphics::OnMouseOut()
 
 void IGraphics::OnMouseDrag(int x, int y, IMouseMod* pMod)
 {
+  WakeRefreshTimer();
   int c = mMouseCapture;
   if (c >= 0)
   {
@@ -971,6 +1330,7 @@ void IGraphics::OnMouseDrag(int x, int y, IMouseMod* pMod)
 
 bool IGraphics::OnMouseDblClick(int x, int y, IMouseMod* pMod)
 {
+  WakeRefreshTimer();
   ReleaseMouseCapture();
   bool newCapture = false;
   int c = GetMouseControlIdx(x, y);
@@ -995,6 +1355,7 @@ bool IGraphics::OnMouseDblClick(int x, int y, IMouseMod* pMod)
 
 void IGraphics::OnMouseWheel(int x, int y, IMouseMod* pMod, int d)
 {
+  WakeRefreshTimer();
   int c = GetMouseControlIdx(x, y);
   if (c >= 0)
   {
@@ -1009,6 +1370,7 @@ void IGraphics::ReleaseMouseCapture()
 
 bool IGraphics::OnKeyDown(int x, int y, int key)
 {
+  WakeRefreshTimer();
   int c = GetMouseControlIdx(x, y);
   if (c > 0)
     return mControls.Get(c)->OnKeyDown(x, y, key);
@@ -37,6 +37,8 @@
 #endif
 
 #define MAX_PARAM_LEN 32
+#define MAX_DAMAGE_RECTS 8
+#define DEFAULT_SCALED_BITMAP_BUDGET (32 * 1024 * 1024) // see SetScaledBitmapBudget()
 
 class IPlugBase;
 class IControl;
@@ -48,6 +50,11 @@ public:
   void PrepDraw();    // Called once, when the IGraphics class is attached to the IPlug class.
 
   bool IsDirty(IRECT* pR);        // Ask the plugin what needs to be redrawn.
+  // Disjoint rectangles covering everything IsDirty() found dirty; pR is their union.
+  // OS classes invalidate these rather than the union, so only damaged pixels reach the screen.
+  // The next Draw() redraws exactly this damage and cleans only the controls found dirty here.
+  int GetNDamageRects() const { return mNDamageRects; }
+  IRECT* GetDamageRect(int i) { return &mDamageRects[i]; }
   bool Draw(IRECT* pR);           // The system announces what needs to be redrawn.  Ordering and drawing logic.
   virtual bool DrawScreen(IRECT* pR) = 0;  // Tells the OS class to put the final bitmap on the screen.
 
@@ -116,9 +123,10 @@ public:
 
   // Strict (default): draw everything within the smallest rectangle that contains everything dirty.
   // Every control is guaranteed to get no more than one Draw() call per cycle.
-  // Fast: draw only controls that intersect something dirty.
-  // If there are overlapping controls, fast drawing can generate multiple Draw() calls per cycle
-  // (a control may be asked to draw multiple parts of itself, if it intersects with something dirty.)
+  // Fast: dirty rectangles are merged into a few disjoint damage rectangles, and each one is redrawn
+  // by drawing the controls that intersect it in z-order, clipped to it.
+  // A control spanning several damage rectangles gets one Draw() call for each of them
+  // (it is asked to draw multiple parts of itself.)
   void SetStrictDrawing(bool strict);
 
   virtual void* OpenWindow(void* pParentWnd) = 0;
@@ -141,10 +149,29 @@ public:
   int Height() { return mHeight; }
   int FPS() { return mFPS; }
 
+  // Adaptive refresh: the OS timer runs at FPS() while controls change or the mouse is captured.
+  // After IDLE_HOLD_MS without changes it slows down to the idle rate (0 keeps it at FPS()),
+  // and the next change or GUI event brings it back to full rate.
+  void SetIdleFPS(int idleFPS) { mIdleFPS = idleFPS; }
+  // Called by OS classes when they create their timer; returns the interval to start it with, in ms.
+  int StartRefreshTimer();
+  // Called by OS classes on each timer tick instead of IsDirty(); re-arms the timer through SetRefreshTimer() as needed.
+  bool OnRefreshTimer(IRECT* pR);
+  // GUI thread only: something is going on, go back to full rate now.
+  void WakeRefreshTimer();
+
   IPlugBase* GetPlug() { return mPlug; }
 
   IBitmap LoadIBitmap(int ID, const char* name, int nStates = 1, bool framesAreHoriztonal = false);
+  // Scaled bitmaps are shared by all IGraphics instances and each multi-state frame is scaled separately.
+  // They stay valid until ReleaseBitmap or until this IGraphics is destroyed.
   IBitmap ScaleBitmap(IBitmap* pSrcBitmap, int destW, int destH);
+  // LoadIBitmap with every frame scaled by scale (e.g. 2.0 for a HiDPI editor), precomputed once.
+  IBitmap LoadScaledIBitmap(int ID, const char* name, int nStates, double scale, bool framesAreHoriztonal = false);
+  // Memory kept for scaled bitmaps no open editor uses; least recently used ones are freed beyond this.
+  static void SetScaledBitmapBudget(int bytes);
+  // Memory currently held by scaled bitmaps, used or not.
+  static int GetScaledBitmapBytes();
   IBitmap CropBitmap(IBitmap* pSrcBitmap, IRECT* pR);
   void AttachBackground(int ID, const char* name);
   void AttachPanelBackground(const IColor *pColor);
@@ -258,6 +285,8 @@ protected:
   inline bool TooltipsEnabled() const { return mEnableTooltips; }
   
   virtual LICE_IBitmap* OSLoadBitmap(int ID, const char* name) = 0;
+  // Re-arms the OS refresh timer with a new interval. Only called from the GUI thread.
+  virtual void SetRefreshTimer(int ms) {}
   
   LICE_SysBitmap* mDrawBitmap;
   LICE_IFont* CacheFont(IText* pTxt);
@@ -268,8 +297,17 @@ protected:
 
 private:
   LICE_MemBitmap* mTmpBitmap;
+  WDL_PtrList<LICE_IBitmap> mScaledBitmaps; // references held in the shared scaled bitmap cache
   int mWidth, mHeight, mFPS, mIdleTicks;
   int GetMouseControlIdx(int x, int y, bool mo = false);
+  int RefreshInterval();
+  void UpdateRefreshTimer();
+  int mIdleFPS, mQuietTicks, mTimerMs;
+  void CollectDamage();
+  void AddDamage(IRECT r);
+  IRECT mDamageRects[MAX_DAMAGE_RECTS];
+  int mNDamageRects;
+  WDL_TypedBuf<bool> mDamagedControls; // by control index, dirty when the damage was collected
   int mMouseCapture, mMouseOver, mMouseX, mMouseY, mLastClickedParam;
   bool mHandleMouseOver, mStrict, mEnableTooltips, mShowControlBounds;
   IControl* mKeyCatcher;
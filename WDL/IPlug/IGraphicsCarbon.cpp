@@ -94,7 +94,7 @@ IGraphicsCarbon::IGraphicsCarbon(IGraphicsMac* pGraphicsMac,
 
   InstallWindowEventHandler(mWindow, MainEventHandler, GetEventTypeCount(windowEvents), windowEvents, this, &mWindowHandler);
 
-  double t = kEventDurationSecond / (double) pGraphicsMac->FPS();
+  double t = kEventDurationMillisecond * (double) pGraphicsMac->StartRefreshTimer();
 
   OSStatus s = InstallEventLoopTimer(GetMainEventLoop(), 0., t, TimerHandler, this, &mTimer);
 
@@ -154,6 +154,16 @@ IGraphicsCarbon::~IGraphicsCarbon()
   mView = 0;
 }
 
+void IGraphicsCarbon::SetTimerInterval(int ms)
+{
+  if (mTimer)
+  {
+    RemoveEventLoopTimer(mTimer);
+    double t = kEventDurationMillisecond * (double) ms;
+    InstallEventLoopTimer(GetMainEventLoop(), t, t, TimerHandler, this, &mTimer);
+  }
+}
+
 bool IGraphicsCarbon::Resize(int w, int h)
 {
   if (mWindow && mView)
@@ -581,12 +591,28 @@ pascal void IGraphicsCarbon::TimerHandler(EventLoopTimerRef pTimer, void* pGraph
 
   IRECT r;
 
-  if (_this->mGraphicsMac->IsDirty(&r))
+  if (_this->mTooltipTimer)
+  {
+    _this->mGraphicsMac->WakeRefreshTimer(); // the tooltip delay is counted in ticks at FPS()
+  }
+
+  if (_this->mGraphicsMac->OnRefreshTimer(&r))
   {
     if (_this->mIsComposited)
     {
-      CGRect tmp = CGRectMake(r.L, r.T, r.W(), r.H());
-      HIViewSetNeedsDisplayInRect(_this->mView, &tmp , true); // invalidate everything that is set dirty
+      CGRect tmp;
+      int i, n = _this->mGraphicsMac->GetNDamageRects();
+      for (i = 0; i < n; ++i)
+      {
+        IRECT* pD = _this->mGraphicsMac->GetDamageRect(i);
+        tmp = CGRectMake(pD->L, pD->T, pD->W(), pD->H());
+        HIViewSetNeedsDisplayInRect(_this->mView, &tmp , true); // invalidate everything that is set dirty
+      }
+      if (!n)
+      {
+        tmp = CGRectMake(r.L, r.T, r.W(), r.H());
+        HIViewSetNeedsDisplayInRect(_this->mView, &tmp , true);
+      }
 
       #if USE_MTLE
       if (_this->mTextEntryView) // validate the text entry rect, otherwise, flicker
@@ -35,6 +35,7 @@ public:
   void CreateTextEntry(IControl* pControl, IText* pText, IRECT* pTextRect, const char* pString, IParam* pParam);
 
   void EndUserInput(bool commit);
+  void SetTimerInterval(int ms);
   
 protected:
   void ShowTooltip();
@@ -87,6 +87,7 @@ NSString* ToNSString(const char* cStr);
 - (void) scrollWheel: (NSEvent*) pEvent;
 - (void) keyDown: (NSEvent *)pEvent;
 - (void) killTimer;
+- (void) setTimerInterval: (double) sec;
 - (void) removeFromSuperview;
 //- (void) controlTextDidChange: (NSNotification *) aNotification;
 - (void) controlTextDidEndEditing: (NSNotification*) aNotification;
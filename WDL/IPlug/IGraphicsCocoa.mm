@@ -232,9 +232,7 @@ inline int GetMouseOver(IGraphicsMac* pGraphics)
   r.size.height = (float) pGraphics->Height();
   self = [super initWithFrame:r];
 
-  double sec = 1.0 / (double) pGraphics->FPS();
-  mTimer = [NSTimer timerWithTimeInterval:sec target:self selector:@selector(onTimer:) userInfo:nil repeats:YES];
-  [[NSRunLoop currentRunLoop] addTimer: mTimer forMode: (NSString*) kCFRunLoopCommonModes];
+  [self setTimerInterval: 0.001 * (double) pGraphics->StartRefreshTimer()];
 
   return self;
 }
@@ -276,9 +274,20 @@ inline int GetMouseOver(IGraphicsMac* pGraphics)
 - (void) onTimer: (NSTimer*) pTimer
 {
   IRECT r;
-  if (pTimer == mTimer && mGraphics && mGraphics->IsDirty(&r))
+  if (pTimer == mTimer && mGraphics && mGraphics->OnRefreshTimer(&r))
   {
-    [self setNeedsDisplayInRect:ToNSRect(mGraphics, &r)];
+    int i, n = mGraphics->GetNDamageRects();
+    if (n > 0)
+    {
+      for (i = 0; i < n; ++i)
+      {
+        [self setNeedsDisplayInRect:ToNSRect(mGraphics, mGraphics->GetDamageRect(i))];
+      }
+    }
+    else
+    {
+      [self setNeedsDisplayInRect:ToNSRect(mGraphics, &r)];
+    }
   }
 }
 
@@ -458,6 +467,13 @@ inline int GetMouseOver(IGraphicsMac* pGraphics)
   mTimer = 0;
 }
 
+- (void) setTimerInterval: (double) sec
+{
+  [mTimer invalidate];
+  mTimer = [NSTimer timerWithTimeInterval:sec target:self selector:@selector(onTimer:) userInfo:nil repeats:YES];
+  [[NSRunLoop currentRunLoop] addTimer: mTimer forMode: (NSString*) kCFRunLoopCommonModes];
+}
+
 - (void) removeFromSuperview
 {
   if (mTextFieldView) [self endUserInput ];
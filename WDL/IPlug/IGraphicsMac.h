@@ -112,6 +112,7 @@ public:
 
 protected:
   virtual LICE_IBitmap* OSLoadBitmap(int ID, const char* name);
+  virtual void SetRefreshTimer(int ms);
   
 private:
 #ifndef IPLUG_NO_CARBON_SUPPORT
@@ -141,6 +141,20 @@ LICE_IBitmap* LoadImgFromResourceOSX(const char* bundleID, const char* filename)
   return 0;
 }
 
+void IGraphicsMac::SetRefreshTimer(int ms)
+{
+  if (mGraphicsCocoa)
+  {
+    [(IGRAPHICS_COCOA*) mGraphicsCocoa setTimerInterval: 0.001 * (double) ms];
+  }
+  #ifndef IPLUG_NO_CARBON_SUPPORT
+  else if (mGraphicsCarbon)
+  {
+    mGraphicsCarbon->SetTimerInterval(ms);
+  }
+  #endif
+}
+
 LICE_IBitmap* IGraphicsMac::OSLoadBitmap(int ID, const char* name)
 {
   return LoadImgFromResourceOSX(GetBundleID(), name);
@@ -15,7 +15,6 @@
 
 static int nWndClassReg = 0;
 static const char* wndClassName = "IPlugWndClass";
-static double sFPS = 0.0;
 
 #define PARAM_EDIT_ID 99
 
@@ -54,7 +53,7 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
   {
     LPCREATESTRUCT lpcs = (LPCREATESTRUCT) lParam;
     SetWindowLongPtr(hWnd, GWLP_USERDATA, (LPARAM) (lpcs->lpCreateParams));
-    int mSec = int(1000.0 / sFPS);
+    int mSec = ((IGraphicsWin*) lpcs->lpCreateParams)->StartRefreshTimer();
     SetTimer(hWnd, IPLUG_TIMER_ID, mSec, NULL);
     SetFocus(hWnd); // gets scroll wheel working straight away
     return 0;
@@ -88,6 +87,7 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
 
         if (pGraphics->mParamEditWnd && pGraphics->mParamEditMsg != kNone)
         {
+          pGraphics->WakeRefreshTimer(); // the edit box is serviced by this timer, so keep it at full rate
           switch (pGraphics->mParamEditMsg)
           {
             case kCommit:
@@ -136,11 +136,25 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
         }
 
         IRECT dirtyR;
-        if (pGraphics->IsDirty(&dirtyR))
+        if (pGraphics->OnRefreshTimer(&dirtyR))
         {
           RECT r = { dirtyR.L, dirtyR.T, dirtyR.R, dirtyR.B };
 
-          InvalidateRect(hWnd, &r, FALSE);
+          // invalidating each damage rect keeps BeginPaint's clip region to what actually changed
+          int nDamage = pGraphics->GetNDamageRects();
+          if (nDamage > 0)
+          {
+            for (int i = 0; i < nDamage; ++i)
+            {
+              IRECT* pD = pGraphics->GetDamageRect(i);
+              RECT dr = { pD->L, pD->T, pD->R, pD->B };
+              InvalidateRect(hWnd, &dr, FALSE);
+            }
+          }
+          else
+          {
+            InvalidateRect(hWnd, &r, FALSE);
+          }
 
           if (pGraphics->mParamEditWnd)
           {
@@ -497,6 +511,14 @@ IGraphicsWin::~IGraphicsWin()
   FREE_NULL(mCustomColorStorage);
 }
 
+void IGraphicsWin::SetRefreshTimer(int ms)
+{
+  if (mPlugWnd)
+  {
+    SetTimer(mPlugWnd, IPLUG_TIMER_ID, ms, NULL); // replaces the running timer
+  }
+}
+
 LICE_IBitmap* IGraphicsWin::OSLoadBitmap(int ID, const char* name)
 {
   const char* ext = name+strlen(name)-1;
@@ -653,7 +675,6 @@ void* IGraphicsWin::OpenWindow(void* pParentWnd)
     RegisterClass(&wndClass);
   }
 
-  sFPS = FPS();
   mPlugWnd = CreateWindow(wndClassName, "IPlug", WS_CHILD | WS_VISIBLE, // | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
                           x, y, w, h, (HWND) pParentWnd, 0, mHInstance, this);
   //SetWindowLong(mPlugWnd, GWL_USERDATA, (LPARAM) this);
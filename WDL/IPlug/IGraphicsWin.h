@@ -62,6 +62,7 @@ public:
   bool GetTextFromClipboard(WDL_String* pStr);
 protected:
   LICE_IBitmap* OSLoadBitmap(int ID, const char* name);
+  void SetRefreshTimer(int ms);
 
   void SetTooltip(const char* tooltip);
   void ShowTooltip();
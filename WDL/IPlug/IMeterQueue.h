@@ -0,0 +1,118 @@
+#ifndef _IMETERQUEUE_
+#define _IMETERQUEUE_
+
+#include <atomic>
+#include <string.h>
+
+/*
+
+IMeterQueue carries level meter readings from the audio thread to the GUI
+without locks. It is a single-producer/single-consumer ring of fixed capacity
+with atomic read and write positions, so neither side ever waits for the
+other and IPlugBase::mMutex is never touched.
+
+The audio thread pushes one IMeterValues per process block with Push(), which
+never blocks or allocates. When the GUI falls behind (editor closed, idle timer
+rate, small host buffers) and the ring is full, Push() drops the oldest reading
+by moving the read position itself, so the newest levels and peaks always get
+through. The GUI drains the ring with Pop(), e.g. from IControl::IsDirty() as
+IMeterControl does, and applies its own ballistics.
+
+Pop() claims a reading by moving the read position with compare-and-swap after
+copying it. If the audio thread dropped that reading meanwhile, the slot may
+have been overwritten during the copy, so the CAS fails and Pop() retries at
+the new position. Slots are stored as relaxed atomic words, so such a torn copy
+is merely discarded rather than a data race.
+
+*/
+
+#define METER_MAX_CHANNELS 2
+
+struct IMeterValues
+{
+  int mNFrames;                           // length of the block the reading covers
+  float mPeak[METER_MAX_CHANNELS];        // linear
+  float mRMS[METER_MAX_CHANNELS];         // linear
+  float mGainReduction;                   // maximum over the block, dB >= 0
+
+  void Clear(int nFrames = 0)
+  {
+    mNFrames = nFrames;
+    for (int c = 0; c < METER_MAX_CHANNELS; ++c)
+    {
+      mPeak[c] = mRMS[c] = 0.0f;
+    }
+    mGainReduction = 0.0f;
+  }
+};
+
+class IMeterQueue
+{
+public:
+  enum { kSize = 128 }; // power of two
+
+  IMeterQueue() : mRead(0), mWrite(0) {}
+
+  // Audio thread. Returns false if the oldest reading was dropped to make room.
+  bool Push(const IMeterValues& values)
+  {
+    bool room = true;
+    unsigned int w = mWrite.load(std::memory_order_relaxed);
+    unsigned int r = mRead.load(std::memory_order_acquire);
+    if (w - r >= kSize)
+    {
+      // if the GUI popped r meanwhile, the CAS fails and there is room anyway
+      mRead.compare_exchange_strong(r, r + 1, std::memory_order_acq_rel, std::memory_order_acquire);
+      room = false;
+    }
+    Store(w & (kSize - 1), values);
+    mWrite.store(w + 1, std::memory_order_release);
+    return room;
+  }
+
+  // GUI thread. Returns false if there are no readings left.
+  bool Pop(IMeterValues* pValues)
+  {
+    unsigned int r = mRead.load(std::memory_order_acquire);
+    for (;;)
+    {
+      if (r == mWrite.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      Load(r & (kSize - 1), pValues);
+      if (mRead.compare_exchange_weak(r, r + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        return true;
+      }
+    }
+  }
+
+private:
+  enum { kWords = (sizeof(IMeterValues) + sizeof(unsigned int) - 1) / sizeof(unsigned int) };
+
+  void Store(unsigned int slot, const IMeterValues& values)
+  {
+    unsigned int words[kWords];
+    memcpy(words, &values, sizeof(IMeterValues));
+    for (int i = 0; i < kWords; ++i)
+    {
+      mBuf[slot][i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+  void Load(unsigned int slot, IMeterValues* pValues)
+  {
+    unsigned int words[kWords];
+    for (int i = 0; i < kWords; ++i)
+    {
+      words[i] = mBuf[slot][i].load(std::memory_order_relaxed);
+    }
+    memcpy(pValues, words, sizeof(IMeterValues));
+  }
+
+  std::atomic<unsigned int> mBuf[kSize][kWords];
+  std::atomic<unsigned int> mRead, mWrite;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef _IPARAMNOTIFYQUEUE_
+#define _IPARAMNOTIFYQUEUE_
+
+#include <atomic>
+
+/*
+
+IParamNotifyQueue carries host parameter changes from the audio thread to the
+GUI without locks. The API classes used to call
+IGraphics::SetParameterFromPlug() straight from setParameter / process, which
+walks every control and may redraw on the audio thread; now they Push() the
+change here and the GUI applies it on its next timer tick (see
+IGraphics::OnRefreshTimer()).
+
+There is one slot per parameter holding the latest normalized value, plus a
+dirty bit per parameter. Push() stores the value and then sets the bit with
+release ordering; it never blocks or allocates, and any number of threads may
+push at once. Pop() clears one set bit with acquire ordering and then reads
+the slot. Changes to the same parameter between two GUI ticks collapse into the
+last one, so the queue can never overflow, however dense the automation. If a
+push lands between clearing a bit and reading its slot, the GUI sees the new
+value now and once more on the next tick, which is harmless.
+
+*/
+
+class IParamNotifyQueue
+{
+public:
+  IParamNotifyQueue() : mNParams(0), mValues(0), mDirty(0) {}
+  ~IParamNotifyQueue()
+  {
+    delete[] mValues;
+    delete[] mDirty;
+  }
+
+  // Not thread safe, call before either side runs (IPlugBase does it in its constructor).
+  void Resize(int nParams)
+  {
+    delete[] mValues;
+    delete[] mDirty;
+    mNParams = nParams;
+    mValues = new std::atomic<double>[nParams > 0 ? nParams : 1];
+    mDirty = new std::atomic<unsigned int>[NWords()];
+    for (int i = 0; i < nParams; ++i)
+    {
+      mValues[i].store(0.0, std::memory_order_relaxed);
+    }
+    for (int w = 0; w < NWords(); ++w)
+    {
+      mDirty[w].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Any thread.
+  void Push(int idx, double normalizedValue)
+  {
+    if (idx >= 0 && idx < mNParams)
+    {
+      mValues[idx].store(normalizedValue, std::memory_order_relaxed);
+      mDirty[idx >> 5].fetch_or(1u << (idx & 31), std::memory_order_release);
+    }
+  }
+
+  // GUI thread. Returns false if no parameter has changed since the last call.
+  bool Pop(int* pIdx, double* pNormalizedValue)
+  {
+    for (int w = 0; w < NWords(); ++w)
+    {
+      unsigned int bits = mDirty[w].load(std::memory_order_relaxed);
+      if (bits)
+      {
+        int b = 0;
+        while (!(bits & (1u << b)))
+        {
+          ++b;
+        }
+        mDirty[w].fetch_and(~(1u << b), std::memory_order_acquire);
+        *pIdx = (w << 5) + b;
+        *pNormalizedValue = mValues[*pIdx].load(std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  int NWords() const { return (mNParams + 31) >> 5 > 0 ? (mNParams + 31) >> 5 : 1; }
+
+  int mNParams;
+  std::atomic<double>* mValues;
+  std::atomic<unsigned int>* mDirty;
+
+  IParamNotifyQueue(const IParamNotifyQueue&);
+  IParamNotifyQueue& operator=(const IParamNotifyQueue&);
+};
+
+#endif
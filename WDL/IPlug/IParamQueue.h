@@ -0,0 +1,122 @@
+#ifndef _IPARAMQUEUE_
+#define _IPARAMQUEUE_
+
+#include <string.h>
+#include "Containers.h"
+
+/*
+
+IParamQueue is a timeline of sample-accurate parameter changes for the current
+process block. The API classes add changes with their sample offsets (VST3
+IParamValueQueue points, AU scheduled parameter events) before calling
+ProcessBuffers(), which splits the block at the change offsets and applies each
+change (SetNormalized + OnParamChange) right before the samples it affects, so
+ProcessDoubleReplacing() is called once per segment.
+
+Changes are kept sorted by offset; changes with equal offsets keep the order
+they were added in. The queue is drained completely in every block.
+
+Add() is called from the audio thread, so it never allocates: the room is
+reserved by IPlugBase::SetBlockSize() for one change per sample plus one per
+parameter. A host sending more than that gets intermediate points merged away,
+but the last value of every parameter is always applied.
+
+*/
+
+struct IParamChange
+{
+  int mOffset;
+  int mIdx;
+  double mNormalizedValue;
+};
+
+class IParamQueue
+{
+public:
+  IParamQueue(int size = 128): mFront(0), mBack(0) { mBuf.Resize(size); }
+
+  // Allocates room for size changes and empties the queue, not for the audio thread.
+  void Reserve(int size)
+  {
+    mBuf.Resize(size);
+    Clear();
+  }
+
+  // Adds a parameter change at the right offset. If the queue is full, an
+  // earlier change is merged away (see MakeRoom()) instead of growing the queue.
+  void Add(int offset, int idx, double normalizedValue)
+  {
+    if (mBack >= mBuf.GetSize())
+    {
+      if (mFront > 0)
+      {
+        Compact();
+      }
+      else if (!MakeRoom(idx, offset))
+      {
+        return;
+      }
+    }
+
+    IParamChange* pBuf = mBuf.Get();
+    int i = mBack;
+    while (i > mFront && offset < pBuf[i - 1].mOffset) --i;
+    memmove(&pBuf[i + 1], &pBuf[i], (mBack - i) * sizeof(IParamChange));
+    pBuf[i].mOffset = offset;
+    pBuf[i].mIdx = idx;
+    pBuf[i].mNormalizedValue = normalizedValue;
+    ++mBack;
+  }
+
+  inline bool Empty() const { return mFront == mBack; }
+  inline int ToDo() const { return mBack - mFront; }
+
+  // Returns the change at the front of the queue.
+  inline const IParamChange* Peek() const { return mBuf.Get() + mFront; }
+  inline void Remove() { ++mFront; }
+
+  // Removes all changes, without freeing space.
+  inline void Clear() { mFront = mBack = 0; }
+
+protected:
+  void Compact()
+  {
+    memmove(mBuf.Get(), mBuf.Get() + mFront, (mBack - mFront) * sizeof(IParamChange));
+    mBack -= mFront;
+    mFront = 0;
+  }
+
+  // Removes the latest queued change of idx at or before offset, which the new
+  // change supersedes, or else the first change of a parameter that has a later
+  // change queued. Returns false if there is neither, then the new change is
+  // dropped.
+  bool MakeRoom(int idx, int offset)
+  {
+    IParamChange* pBuf = mBuf.Get();
+    int drop = -1;
+    for (int i = mBack - 1; i >= mFront && drop < 0; --i)
+    {
+      if (pBuf[i].mIdx == idx && pBuf[i].mOffset <= offset) drop = i;
+    }
+    for (int i = mFront; i < mBack && drop < 0; ++i)
+    {
+      for (int j = i + 1; j < mBack; ++j)
+      {
+        if (pBuf[j].mIdx == pBuf[i].mIdx)
+        {
+          drop = i;
+          break;
+        }
+      }
+    }
+    if (drop < 0) return false;
+    memmove(&pBuf[drop], &pBuf[drop + 1], (mBack - drop - 1) * sizeof(IParamChange));
+    --mBack;
+    return true;
+  }
+
+  WDL_TypedBuf<IParamChange> mBuf;
+  int mFront, mBack;
+};
+
+#endif
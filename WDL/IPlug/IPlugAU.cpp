@@ -1535,10 +1535,7 @@ OSStatus IPlugAU::SetParamProc(void* pPlug, AudioUnitParameterID paramID, AudioU
   IMutexLock lock(_this);
   IParam* pParam = _this->GetParam(paramID);
   pParam->Set(value);
-  if (_this->GetGUI())
-  {
-    _this->GetGUI()->SetParameterFromPlug(paramID, value, false);
-  }
+  _this->InformGUIOfParamChange(paramID, pParam->GetNormalized());
   _this->OnParamChange(paramID);
   return noErr;
 }
@@ -2426,7 +2423,17 @@ OSStatus IPlugAU::DoScheduleParameters(IPlugAU *_this, const AudioUnitParameterE
   
   for (int i = 0; i < nEvents; ++i, ++pEvent)
   {
-    if (pEvent->eventType == kParameterEvent_Immediate)
+    if (pEvent->eventType == kParameterEvent_Immediate && pEvent->eventValues.immediate.bufferOffset > 0 &&
+        pEvent->scope == kAudioUnitScope_Global && pEvent->parameter < _this->NParams())
+    {
+      // scheduled for the next render call, applied sample-accurately by ProcessBuffers
+      int idx = pEvent->parameter;
+      double value = pEvent->eventValues.immediate.value;
+      double normalizedValue = _this->GetParam(idx)->GetNormalized(value);
+      _this->AddParamChange(pEvent->eventValues.immediate.bufferOffset, idx, normalizedValue);
+      _this->InformGUIOfParamChange(idx, normalizedValue);
+    }
+    else if (pEvent->eventType == kParameterEvent_Immediate)
     {
       OSStatus r = SetParamProc(_this, pEvent->parameter, pEvent->scope, pEvent->element,
                                 pEvent->eventValues.immediate.value, pEvent->eventValues.immediate.bufferOffset);
@@ -6,6 +6,7 @@
 #include <time.h>
 #include "../wdlendian.h"
 #include "../base64encdec.h"
+#include "../denormal.h"
 
 #ifndef VstInt32
   #ifdef WIN32
@@ -81,8 +82,10 @@ IPlugBase::IPlugBase(int nParams,
   , mDoesMIDI(plugDoesMidi)
   , mAPI(plugAPI)
   , mIsBypassed(false)
+  , mSingleReplacing(false)
   , mDelay(0)
   , mTailSize(0)
+  , mPendingLatency(-1)
 {
   Trace(TRACELOC, "%s:%s", effectName, CurrentTime());
 
@@ -90,6 +93,7 @@ IPlugBase::IPlugBase(int nParams,
   {
     mParams.Add(new IParam);
   }
+  mGUIParamChanges.Resize(nParams);
 
   for (int i = 0; i < nPresets; ++i)
   {
@@ -124,6 +128,12 @@ IPlugBase::IPlugBase(int nParams,
 
   mInData.Resize(nInputs);
   mOutData.Resize(nOutputs);
+  mInSegment.Resize(nInputs);
+  mOutSegment.Resize(nOutputs);
+  mFInData.Resize(nInputs);
+  mFOutData.Resize(nOutputs);
+  mFInSegment.Resize(nInputs);
+  mFOutSegment.Resize(nOutputs);
   
   double** ppInData = mInData.Get();
 
@@ -132,6 +142,7 @@ IPlugBase::IPlugBase(int nParams,
     InChannel* pInChannel = new InChannel;
     pInChannel->mConnected = false;
     pInChannel->mSrc = ppInData;
+    pInChannel->mFSrc = 0;
     mInChannels.Add(pInChannel);
   }
 
@@ -312,6 +323,8 @@ void IPlugBase::SetBlockSize(int blockSize)
       InChannel* pInChannel = mInChannels.Get(i);
       pInChannel->mScratchBuf.Resize(blockSize);
       memset(pInChannel->mScratchBuf.Get(), 0, blockSize * sizeof(double));
+      pInChannel->mFScratchBuf.Resize(blockSize);
+      memset(pInChannel->mFScratchBuf.Get(), 0, blockSize * sizeof(float));
     }
     
     for (i = 0; i < nOut; ++i)
@@ -319,7 +332,12 @@ void IPlugBase::SetBlockSize(int blockSize)
       OutChannel* pOutChannel = mOutChannels.Get(i);
       pOutChannel->mScratchBuf.Resize(blockSize);
       memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(double));
+      pOutChannel->mFScratchBuf.Resize(blockSize);
+      memset(pOutChannel->mFScratchBuf.Get(), 0, blockSize * sizeof(float));
     }
+
+    // AddParamChange() is called from the audio thread, so the queue doesn't grow there
+    mParamChanges.Reserve(blockSize + NParams());
     
     mBlockSize = blockSize;
   }
@@ -387,7 +405,11 @@ void IPlugBase::AttachInputBuffers(int idx, int n, float** ppData, int nFrames)
   for (int i = idx; i < iEnd; ++i)
   {
     InChannel* pInChannel = mInChannels.Get(i);
-    if (pInChannel->mConnected)
+    if (pInChannel->mConnected && mSingleReplacing)
+    {
+      pInChannel->mFSrc = *(ppData++); // converted only if needed, see PassThroughBuffers
+    }
+    else if (pInChannel->mConnected)
     {
       double* pScratch = pInChannel->mScratchBuf.Get();
       CastCopy(pScratch, *(ppData++), nFrames);
@@ -425,6 +447,8 @@ void IPlugBase::AttachOutputBuffers(int idx, int n, float** ppData)
 
 void IPlugBase::PassThroughBuffers(double sampleType, int nFrames)
 {
+  ApplyParamChanges(nFrames, nFrames); // keep parameters in sync while bypassed
+
   if (mLatency && mDelay) 
   {
     mDelay->ProcessBlock(mInData.Get(), mOutData.Get(), nFrames);
@@ -437,6 +461,31 @@ void IPlugBase::PassThroughBuffers(double sampleType, int nFrames)
 
 void IPlugBase::PassThroughBuffers(float sampleType, int nFrames)
 {
+  if (mSingleReplacing && !(mLatency && mDelay))
+  {
+    // no delay line to feed, so the host buffers are passed through as they are
+    ApplyParamChanges(nFrames, nFrames); // keep parameters in sync while bypassed
+    GetSingleBuffers(mFInData.Get(), mFOutData.Get(), false);
+    IPlugBase::ProcessSingleReplacing(mFInData.Get(), mFOutData.Get(), nFrames);
+    return;
+  }
+
+  if (mSingleReplacing)
+  {
+    // the delay line works on the 64bit IPlug buffers, so convert the inputs attached without copying
+    int i, n = NInChannels();
+    for (i = 0; i < n; ++i)
+    {
+      InChannel* pInChannel = mInChannels.Get(i);
+      if (pInChannel->mConnected)
+      {
+        double* pScratch = pInChannel->mScratchBuf.Get();
+        CastCopy(pScratch, pInChannel->mFSrc, nFrames);
+        *(pInChannel->mSrc) = pScratch;
+      }
+    }
+  }
+
   // for 32 bit buffers, first run the delay (if mLatency) on the 64bit IPlug buffers
   PassThroughBuffers(0., nFrames);
   
@@ -453,14 +502,122 @@ void IPlugBase::PassThroughBuffers(float sampleType, int nFrames)
   }
 }
 
+// Applies queued parameter changes up to and including offset, returns the offset of the next change (or nFrames).
+// Changes at or past nFrames stay queued until the call with offset == nFrames, after the last segment.
+int IPlugBase::ApplyParamChanges(int offset, int nFrames)
+{
+  while (!mParamChanges.Empty())
+  {
+    const IParamChange* pChange = mParamChanges.Peek();
+    if (pChange->mOffset > offset && offset < nFrames)
+    {
+      return IPMIN(pChange->mOffset, nFrames);
+    }
+    GetParam(pChange->mIdx)->SetNormalized(pChange->mNormalizedValue);
+    OnParamChange(pChange->mIdx);
+    mParamChanges.Remove();
+  }
+  mParamChanges.Clear();
+  return nFrames;
+}
+
+// Fills single precision channel tables with the host buffers, or float scratch buffers for unconnected channels.
+void IPlugBase::GetSingleBuffers(float** ppInData, float** ppOutData, bool outputToScratch)
+{
+  int i, nIn = NInChannels(), nOut = NOutChannels();
+
+  for (i = 0; i < nIn; ++i)
+  {
+    InChannel* pInChannel = mInChannels.Get(i);
+    ppInData[i] = (pInChannel->mConnected ? pInChannel->mFSrc : pInChannel->mFScratchBuf.Get());
+  }
+
+  for (i = 0; i < nOut; ++i)
+  {
+    OutChannel* pOutChannel = mOutChannels.Get(i);
+    ppOutData[i] = (pOutChannel->mConnected && !outputToScratch ? pOutChannel->mFDest : pOutChannel->mFScratchBuf.Get());
+  }
+}
+
+// Calls ProcessSingleReplacing once for each segment of the block between queued parameter changes.
+void IPlugBase::ProcessSegments(float** ppInData, float** ppOutData, int nFrames)
+{
+  if (mParamChanges.Empty())
+  {
+    ProcessSingleReplacing(ppInData, ppOutData, nFrames);
+    return;
+  }
+
+  int i, nIn = NInChannels(), nOut = NOutChannels();
+  float** ppInSegment = mFInSegment.Get();
+  float** ppOutSegment = mFOutSegment.Get();
+
+  for (int offset = 0; offset < nFrames; )
+  {
+    int next = ApplyParamChanges(offset, nFrames);
+    for (i = 0; i < nIn; ++i)
+    {
+      ppInSegment[i] = ppInData[i] + offset;
+    }
+    for (i = 0; i < nOut; ++i)
+    {
+      ppOutSegment[i] = ppOutData[i] + offset;
+    }
+    ProcessSingleReplacing(ppInSegment, ppOutSegment, next - offset);
+    offset = next;
+  }
+  ApplyParamChanges(nFrames, nFrames);
+}
+
+// Calls ProcessDoubleReplacing once for each segment of the block between queued parameter changes.
+void IPlugBase::ProcessSegments(int nFrames)
+{
+  if (mParamChanges.Empty())
+  {
+    ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+    return;
+  }
+
+  int i, nIn = NInChannels(), nOut = NOutChannels();
+  double** ppInData = mInData.Get();
+  double** ppOutData = mOutData.Get();
+  double** ppInSegment = mInSegment.Get();
+  double** ppOutSegment = mOutSegment.Get();
+
+  for (int offset = 0; offset < nFrames; )
+  {
+    int next = ApplyParamChanges(offset, nFrames);
+    for (i = 0; i < nIn; ++i)
+    {
+      ppInSegment[i] = ppInData[i] + offset;
+    }
+    for (i = 0; i < nOut; ++i)
+    {
+      ppOutSegment[i] = ppOutData[i] + offset;
+    }
+    ProcessDoubleReplacing(ppInSegment, ppOutSegment, next - offset);
+    offset = next;
+  }
+  ApplyParamChanges(nFrames, nFrames);
+}
+
 void IPlugBase::ProcessBuffers(double sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  WDL_DenormalFlushScope denormalScope; // FTZ/DAZ for the plug-in's processing, restored for the host
+  ProcessSegments(nFrames);
 }
 
 void IPlugBase::ProcessBuffers(float sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  WDL_DenormalFlushScope denormalScope;
+  if (mSingleReplacing)
+  {
+    GetSingleBuffers(mFInData.Get(), mFOutData.Get(), false);
+    ProcessSegments(mFInData.Get(), mFOutData.Get(), nFrames);
+    return;
+  }
+
+  ProcessSegments(nFrames);
   int i, n = NOutChannels();
   OutChannel** ppOutChannel = mOutChannels.GetList();
   
@@ -477,7 +634,32 @@ void IPlugBase::ProcessBuffers(float sampleType, int nFrames)
 
 void IPlugBase::ProcessBuffersAccumulating(float sampleType, int nFrames)
 {
-  ProcessDoubleReplacing(mInData.Get(), mOutData.Get(), nFrames);
+  WDL_DenormalFlushScope denormalScope;
+  if (mSingleReplacing)
+  {
+    GetSingleBuffers(mFInData.Get(), mFOutData.Get(), true);
+    ProcessSegments(mFInData.Get(), mFOutData.Get(), nFrames);
+    float** ppOutData = mFOutData.Get();
+    int i, n = NOutChannels();
+
+    for (i = 0; i < n; ++i)
+    {
+      OutChannel* pOutChannel = mOutChannels.Get(i);
+      if (pOutChannel->mConnected)
+      {
+        float* pDest = pOutChannel->mFDest;
+        float* pSrc = ppOutData[i];
+
+        for (int j = 0; j < nFrames; ++j, ++pDest, ++pSrc)
+        {
+          *pDest += *pSrc;
+        }
+      }
+    }
+    return;
+  }
+
+  ProcessSegments(nFrames);
   int i, n = NOutChannels();
   OutChannel** ppOutChannel = mOutChannels.GetList();
   
@@ -505,18 +687,22 @@ void IPlugBase::ZeroScratchBuffers()
   {
     InChannel* pInChannel = mInChannels.Get(i);
     memset(pInChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(double));
+    memset(pInChannel->mFScratchBuf.Get(), 0, mBlockSize * sizeof(float));
   }
 
   for (i = 0; i < nOut; ++i)
   {
     OutChannel* pOutChannel = mOutChannels.Get(i);
     memset(pOutChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(double));
+    memset(pOutChannel->mFScratchBuf.Get(), 0, mBlockSize * sizeof(float));
   }
 }
 
 // If latency changes after initialization (often not supported by the host).
 void IPlugBase::SetLatency(int samples)
 {
+  // the bypass delay line is used by the audio thread
+  WDL_MutexLock lock(&mMutex);
   mLatency = samples;
   
   if (mDelay) 
@@ -525,6 +711,15 @@ void IPlugBase::SetLatency(int samples)
   }
 }
 
+void IPlugBase::ReportPendingLatency()
+{
+  int samples = mPendingLatency.exchange(-1, std::memory_order_acquire);
+  if (samples >= 0 && samples != mLatency)
+  {
+    SetLatency(samples);
+  }
+}
+
 // this is over-ridden for AAX
 void IPlugBase::SetParameterFromGUI(int idx, double normalizedValue)
 {
@@ -565,6 +760,24 @@ void IPlugBase::ProcessDoubleReplacing(double** inputs, double** outputs, int nF
   }
 }
 
+// Default passthrough, for 32 bit host buffers that may be processed in place.
+void IPlugBase::ProcessSingleReplacing(float** inputs, float** outputs, int nFrames)
+{
+  // Mutex is already locked.
+  int i, nIn = mInChannels.GetSize(), nOut = mOutChannels.GetSize();
+  for (i = 0; i < nOut; ++i)
+  {
+    if (i >= nIn)
+    {
+      memset(outputs[i], 0, nFrames * sizeof(float));
+    }
+    else if (outputs[i] != inputs[i])
+    {
+      memmove(outputs[i], inputs[i], nFrames * sizeof(float));
+    }
+  }
+}
+
 // Default passthrough.
 void IPlugBase::ProcessMidiMsg(IMidiMsg* pMsg)
 {
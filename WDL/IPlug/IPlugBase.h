@@ -10,6 +10,9 @@
 #include "Hosts.h"
 #include "Log.h"
 #include "NChanDelay.h"
+#include "IParamQueue.h"
+#include "IParamNotifyQueue.h"
+#include <atomic>
 
 // Uncomment to enable IPlug::OnIdle() and IGraphics::OnGUIIdle().
 // #define USE_IDLE_CALLS
@@ -54,6 +57,12 @@ public:
   // Default passthrough.  Inputs and outputs are [nChannel][nSample].
   // Mutex is already locked.
   virtual void ProcessDoubleReplacing(double** inputs, double** outputs, int nFrames);
+
+  // Optional native single precision processing, called instead of ProcessDoubleReplacing for 32 bit
+  // host buffers once SetSingleReplacing(true) has been called. Inputs and outputs are the host buffers
+  // [nChannel][nSample] (no conversion to double scratch buffers), they may point to the same memory.
+  // Default passthrough.  Mutex is already locked.
+  virtual void ProcessSingleReplacing(float** inputs, float** outputs, int nFrames);
   
   // In case the audio processing thread needs to do anything when the GUI opens
   // (like for example, set some state dependent initial values for controls).
@@ -65,6 +74,11 @@ public:
   // Only active if USE_IDLE_CALLS is defined.
   virtual void OnIdle() {}
 
+  // Called from the GUI or host main thread, along with ReportPendingLatency(), for work the audio
+  // thread can't do itself, like allocating. Active without USE_IDLE_CALLS.
+  // Implementations should set a mutex lock when touching state the audio thread uses.
+  virtual void OnMainThreadIdle() {}
+
   // Not usually needed ... Reset is called on activate regardless of whether this is implemented.
   // Also different hosts have different interpretations of "activate".
   // Implementations should set a mutex lock like in the no-op!
@@ -99,6 +113,10 @@ public:
   int NParams() { return mParams.GetSize(); }
   IParam* GetParam(int idx) { return mParams.Get(idx); }
   IGraphics* GetGUI() { return mGraphics; }
+  // GUI thread, see InformGUIOfParamChange().
+  bool PopGUIParamChange(int* pIdx, double* pNormalizedValue) { return mGUIParamChanges.Pop(pIdx, pNormalizedValue); }
+  // GUI or host main thread (IGraphics::OnRefreshTimer(), VST2 idle), see RequestLatency().
+  void ReportPendingLatency();
 
   const char* GetEffectName() { return mEffectName; }
   int GetEffectVersion(bool decimal);   // Decimal = VVVVRRMM, otherwise 0xVVVVRRMM.
@@ -128,6 +146,10 @@ public:
 
   bool GetIsBypassed() { return mIsBypassed; }
 
+  // Call from your constructor if the plugin implements ProcessSingleReplacing.
+  void SetSingleReplacing(bool singleReplacing) { mSingleReplacing = singleReplacing; }
+  bool DoesSingleReplacing() { return mSingleReplacing; }
+
   // In ProcessDoubleReplacing you are always guaranteed to get valid pointers
   // to all the channels the plugin requested.  If the host hasn't connected all the pins,
   // the unconnected channels will be full of zeros.
@@ -194,6 +216,9 @@ protected:
 
   // If latency changes after initialization (often not supported by the host).
   virtual void SetLatency(int samples);
+  // Lock-free, so it can be called from the audio thread: hosts must be told about a latency change from
+  // their main thread, so the latency is passed to SetLatency() by the next ReportPendingLatency() call.
+  void RequestLatency(int samples) { mPendingLatency.store(samples, std::memory_order_release); }
   
   // set to 0xffffffff for infinite tail (VST3), or 0 for none (default)
   // for VST2 setting to 1 means no tail, but it would be better i think to leave it at 0, the default
@@ -252,6 +277,15 @@ protected:
   void ProcessBuffers(double sampleType, int nFrames);
   void ProcessBuffersAccumulating(float sampleType, int nFrames);
   void ZeroScratchBuffers();
+
+  // Queue a parameter change at a sample offset in the next ProcessBuffers* / PassThroughBuffers call.
+  // ProcessDoubleReplacing is then called separately for the samples before and after the change.
+  // Call with the mutex locked, from the audio thread, right before processing.
+  void AddParamChange(int offset, int idx, double normalizedValue) { mParamChanges.Add(offset, idx, normalizedValue); }
+
+  // Tell the GUI about a parameter change made by the host. Lock-free, so it can be called from the audio thread;
+  // the GUI applies it on its next timer tick instead of the caller calling IGraphics::SetParameterFromPlug().
+  void InformGUIOfParamChange(int idx, double normalizedValue) { mGUIParamChanges.Push(idx, normalizedValue); }
   
 public:
   void ModifyCurrentPreset(const char* name = 0);     // Sets the currently active preset to whatever current params are.
@@ -301,7 +335,9 @@ private:
   {
     bool mConnected;
     double** mSrc;   // Points into mInData.
+    float* mFSrc;    // Host buffer, single replacing only.
     WDL_TypedBuf<double> mScratchBuf;
+    WDL_TypedBuf<float> mFScratchBuf;
     WDL_String mLabel;
   };
 
@@ -311,11 +347,12 @@ private:
     double** mDest;  // Points into mOutData.
     float* mFDest;
     WDL_TypedBuf<double> mScratchBuf;
+    WDL_TypedBuf<float> mFScratchBuf;
     WDL_String mLabel;
   };
 
 protected:
-  bool mStateChunks, mIsInst, mDoesMIDI, mIsBypassed;
+  bool mStateChunks, mIsInst, mDoesMIDI, mIsBypassed, mSingleReplacing;
   int mCurrentPresetIdx;
   double mSampleRate;
   int mBlockSize, mLatency;
@@ -328,10 +365,20 @@ private:
   WDL_PtrList<IParam> mParams;
   WDL_PtrList<IPreset> mPresets;
   WDL_TypedBuf<double*> mInData, mOutData;
+  WDL_TypedBuf<double*> mInSegment, mOutSegment; // mInData/mOutData offset to the current segment.
+  WDL_TypedBuf<float*> mFInData, mFOutData, mFInSegment, mFOutSegment; // Single replacing only.
+  IParamQueue mParamChanges;
+  IParamNotifyQueue mGUIParamChanges;
+  std::atomic<int> mPendingLatency; // -1 if there's no RequestLatency() to report
   WDL_PtrList<InChannel> mInChannels;
   WDL_PtrList<OutChannel> mOutChannels;
   WDL_PtrList<WDL_String> mInputBusLabels;
   WDL_PtrList<WDL_String> mOutputBusLabels;
+
+  void ProcessSegments(int nFrames);
+  void ProcessSegments(float** ppInData, float** ppOutData, int nFrames);
+  void GetSingleBuffers(float** ppInData, float** ppOutData, bool outputToScratch);
+  int ApplyParamChanges(int offset, int nFrames);
 };
 
 #endif
@@ -248,6 +248,8 @@ void IPlugVST::SetLatency(int samples)
 {
   mAEffect.initialDelay = samples;
   IPlugBase::SetLatency(samples);
+  // the host re-reads initialDelay
+  mHostCallback(&mAEffect, audioMasterIOChanged, 0, 0, 0, 0.0f);
 }
 
 bool IPlugVST::SendVSTEvent(VstEvent* pEvent)
@@ -338,6 +340,8 @@ VstIntPtr VSTCALLBACK IPlugVST::VSTDispatcher(AEffect *pEffect, VstInt32 opCode,
   {
     case effEditIdle:
     case __effIdleDeprecated:
+    _this->ReportPendingLatency();
+    _this->OnMainThreadIdle();
     #ifdef USE_IDLE_CALLS
     _this->OnIdle();
     #endif
@@ -901,11 +905,8 @@ void VSTCALLBACK IPlugVST::VSTSetParameter(AEffect *pEffect, VstInt32 idx, float
  // IMutexLock lock(_this);
   if (idx >= 0 && idx < _this->NParams())
   {
-    if (_this->GetGUI())
-    {
-      _this->GetGUI()->SetParameterFromPlug(idx, value, true);
-    }
     _this->GetParam(idx)->SetNormalized(value);
+    _this->InformGUIOfParamChange(idx, value);
     _this->OnParamChange(idx);
   }
 }
@@ -371,8 +371,8 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
   {
     int32 numParamsChanged = paramChanges->getParameterCount();
 
-    //it is possible to get a finer resolution of control here by retrieving more values (points) from the queue
-    //for now we just grab the last one
+    //plugin parameters get every point of the queue, applied sample-accurately by ProcessBuffers
+    //bypass and preset changes just use the last one
 
     for (int32 i = 0; i < numParamsChanged; i++)
     {
@@ -407,9 +407,17 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
             default:
               if (idx >= 0 && idx < NParams())
               {
-                GetParam(idx)->SetNormalized((double)value);
-                if (GetGUI()) GetGUI()->SetParameterFromPlug(idx, (double)value, true);
-                OnParamChange(idx);
+                for (int32 j = 0; j < numPoints; j++)
+                {
+                  int32 pointOffset;
+                  double pointValue;
+
+                  if (paramQueue->getPoint(j, pointOffset, pointValue) == kResultTrue)
+                  {
+                    AddParamChange(pointOffset, idx, pointValue);
+                  }
+                }
+                InformGUIOfParamChange(idx, value);
               }
               break;
           }
@@ -479,7 +487,7 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
         }
 
         AttachInputBuffers(0, NInChannels() - mScChans, data.inputs[0].channelBuffers32, data.numSamples);
-        AttachInputBuffers(mScChans, NInChannels() - mScChans, data.inputs[1].channelBuffers32, data.numSamples);
+        AttachInputBuffers(NInChannels() - mScChans, mScChans, data.inputs[1].channelBuffers32, data.numSamples);
       }
       else
       {
@@ -530,7 +538,7 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
         }
 
         AttachInputBuffers(0, NInChannels() - mScChans, data.inputs[0].channelBuffers64, data.numSamples);
-        AttachInputBuffers(mScChans, NInChannels() - mScChans, data.inputs[1].channelBuffers64, data.numSamples);
+        AttachInputBuffers(NInChannels() - mScChans, mScChans, data.inputs[1].channelBuffers64, data.numSamples);
       }
       else
       {
@@ -987,7 +995,8 @@ void IPlugVST3::SetLatency(int latency)
   IPlugBase::SetLatency(latency);
 
   FUnknownPtr<IComponentHandler>handler(componentHandler);
-  handler->restartComponent(kLatencyChanged);  
+  if (handler)
+    handler->restartComponent(kLatencyChanged);
 }
 
 void IPlugVST3::PopupHostContextMenuForParam(int param, int x, int y)
@@ -0,0 +1,155 @@
+/*
+  Checks the non-strict IGraphics::Draw() against the damage the timer collected with IsDirty():
+  only that damage is redrawn, only the controls that were dirty at the tick are cleaned, and a
+  control that turns dirty between the tick and the paint (a knob set by the host, a meter whose
+  queue received new readings) stays dirty until the next tick puts it in the damage.
+
+  No window is opened and nothing is drawn, the test controls only record where they were asked
+  to draw.
+
+    make draw_damage_test && ./draw_damage_test
+
+  Returns nonzero on any failure.
+*/
+
+#include "../IGraphics.h"
+
+#include <stdio.h>
+
+class TestGraphics : public IGraphics
+{
+public:
+  TestGraphics(int w, int h) : IGraphics(0, w, h) {}
+
+  IRECT* DrawRECT() { return &mDrawRECT; }
+
+  bool DrawScreen(IRECT* pR) { return true; }
+  void ForceEndUserEdit() {}
+  int ShowMessageBox(const char* pText, const char* pCaption, int type) { return 0; }
+  IPopupMenu* CreateIPopupMenu(IPopupMenu* pMenu, IRECT* pTextRect) { return 0; }
+  void CreateTextEntry(IControl* pControl, IText* pText, IRECT* pTextRect, const char* pString, IParam* pParam) {}
+  void HostPath(WDL_String* pPath) {}
+  void PluginPath(WDL_String* pPath) {}
+  void DesktopPath(WDL_String* pPath) {}
+  void AppSupportPath(WDL_String* pPath, bool isSystem) {}
+  void SandboxSafeAppSupportPath(WDL_String* pPath) {}
+  void PromptForFile(WDL_String* pFilename, EFileAction action, WDL_String* pDir, char* extensions) {}
+  bool PromptForColor(IColor* pColor, char* prompt) { return false; }
+  bool OpenURL(const char* url, const char* msgWindowTitle, const char* confirmMsg, const char* errMsgOnFailure) { return false; }
+  void* OpenWindow(void* pParentWnd) { return 0; }
+  void CloseWindow() {}
+  void* GetWindow() { return 0; }
+  bool GetTextFromClipboard(WDL_String* pStr) { return false; }
+  void UpdateTooltips() {}
+
+protected:
+  LICE_IBitmap* OSLoadBitmap(int ID, const char* name) { return 0; }
+};
+
+// Like IMeterControl, it only finds out that it has to redraw when IsDirty() is called.
+class TestControl : public IControl
+{
+public:
+  TestControl(IRECT r) : IControl(0, r), mPending(false), mNDraws(0) { mRedraw = false; }
+
+  bool IsDirty()
+  {
+    if (mPending)
+    {
+      mPending = false;
+      mDirty = true;
+    }
+    return mDirty;
+  }
+
+  bool Draw(IGraphics* pGraphics)
+  {
+    ++mNDraws;
+    mDrawnIn = mDrawnIn.Union(((TestGraphics*) pGraphics)->DrawRECT());
+    return true;
+  }
+
+  bool DirtyFlag() const { return mDirty; }
+  void Reset() { mNDraws = 0; mDrawnIn = IRECT(); }
+
+  bool mPending;
+  int mNDraws;
+  IRECT mDrawnIn;
+};
+
+static int sErrors = 0;
+
+static void Check(bool ok, const char* what)
+{
+  printf("%-64s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) ++sErrors;
+}
+
+static void ResetDraws(TestControl** ppControls, int n)
+{
+  for (int i = 0; i < n; ++i) ppControls[i]->Reset();
+}
+
+int main()
+{
+  TestGraphics graphics(100, 100);
+  graphics.SetStrictDrawing(false);
+
+  TestControl* pBG = new TestControl(IRECT(0, 0, 100, 100));
+  TestControl* pKnob = new TestControl(IRECT(10, 10, 30, 30));
+  TestControl* pMeter = new TestControl(IRECT(60, 60, 80, 80));
+  TestControl* pLabel = new TestControl(IRECT(20, 20, 40, 40)); // overlaps the knob
+  TestControl* controls[] = { pBG, pKnob, pMeter, pLabel };
+  const int n = sizeof(controls) / sizeof(controls[0]);
+  for (int i = 0; i < n; ++i) graphics.AttachControl(controls[i]);
+
+  IRECT r;
+  Check(graphics.IsDirty(&r) && r == IRECT(0, 0, 100, 100), "first tick damages the whole window");
+  graphics.Draw(&r);
+  Check(!pBG->DirtyFlag() && !pKnob->DirtyFlag() && !pMeter->DirtyFlag() && !pLabel->DirtyFlag(),
+        "first paint cleans everything");
+
+  // the knob changes, the timer ticks, then the meter and the label change before the paint
+  pKnob->SetDirty(false);
+  r = IRECT();
+  Check(graphics.IsDirty(&r) && r == IRECT(10, 10, 30, 30), "tick damages the knob only");
+  pMeter->mPending = true;
+  pLabel->SetDirty(false);
+  ResetDraws(controls, n);
+  graphics.Draw(&r);
+  Check(pKnob->mNDraws == 1 && pKnob->mDrawnIn == IRECT(10, 10, 30, 30), "paint draws the knob once, in the damage");
+  Check(pBG->mNDraws == 1 && pBG->mDrawnIn == IRECT(10, 10, 30, 30), "background is drawn in the damage only");
+  Check(pMeter->mNDraws == 0, "meter dirty after the tick is not drawn");
+  Check(pMeter->mPending, "paint does not poll the meter");
+  Check(pLabel->mNDraws == 1 && pLabel->DirtyFlag(), "label dirty after the tick is drawn but stays dirty");
+  Check(!pKnob->DirtyFlag(), "knob is clean");
+
+  // the next tick picks up what the paint left
+  r = IRECT();
+  Check(graphics.IsDirty(&r), "next tick is dirty");
+  Check(graphics.GetNDamageRects() == 2, "next tick damages the meter and the label");
+  ResetDraws(controls, n);
+  graphics.Draw(&r);
+  Check(pMeter->mNDraws == 1 && pMeter->mDrawnIn == IRECT(60, 60, 80, 80) && !pMeter->DirtyFlag(), "meter drawn and clean");
+  Check(pLabel->mNDraws == 1 && pLabel->mDrawnIn == IRECT(20, 20, 40, 40) && !pLabel->DirtyFlag(), "label drawn and clean");
+  Check(pKnob->mNDraws == 1 && pKnob->mDrawnIn == IRECT(20, 20, 40, 40), "knob redrawn in the label's damage only");
+
+  // a paint the timer did not ask for redraws the OS area and cleans nothing
+  r = IRECT();
+  Check(!graphics.IsDirty(&r), "idle tick is not dirty");
+  pMeter->SetDirty(false);
+  r = IRECT(50, 50, 100, 100);
+  ResetDraws(controls, n);
+  graphics.Draw(&r);
+  Check(pBG->mNDraws == 1 && pBG->mDrawnIn == IRECT(50, 50, 100, 100), "expose redraws the OS area");
+  Check(pMeter->mNDraws == 1 && pMeter->DirtyFlag(), "expose leaves the meter dirty for the next tick");
+  Check(pKnob->mNDraws == 0 && pLabel->mNDraws == 0, "expose skips controls outside the OS area");
+
+  if (sErrors)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+  Checks the scaled bitmap cache behind IGraphics::LoadScaledIBitmap(): scaled strips are shared by
+  all IGraphics instances, kept after the last editor closes while they fit the memory budget (32 MB
+  by default) and dropped least recently used first beyond it, and a released source bitmap never
+  matches a cached entry again, even if a new bitmap gets its address.
+
+  No window is opened, the "resources" are blank knob strips of 128 frames of 48 x 48.
+
+    make scaled_bitmap_cache_test && ./scaled_bitmap_cache_test
+
+  Returns nonzero on any failure.
+*/
+
+#include "../IGraphics.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+class TestGraphics : public IGraphics
+{
+public:
+  TestGraphics() : IGraphics(0, 100, 100) {}
+
+  bool DrawScreen(IRECT* pR) { return true; }
+  void ForceEndUserEdit() {}
+  int ShowMessageBox(const char* pText, const char* pCaption, int type) { return 0; }
+  IPopupMenu* CreateIPopupMenu(IPopupMenu* pMenu, IRECT* pTextRect) { return 0; }
+  void CreateTextEntry(IControl* pControl, IText* pText, IRECT* pTextRect, const char* pString, IParam* pParam) {}
+  void HostPath(WDL_String* pPath) {}
+  void PluginPath(WDL_String* pPath) {}
+  void DesktopPath(WDL_String* pPath) {}
+  void AppSupportPath(WDL_String* pPath, bool isSystem) {}
+  void SandboxSafeAppSupportPath(WDL_String* pPath) {}
+  void PromptForFile(WDL_String* pFilename, EFileAction action, WDL_String* pDir, char* extensions) {}
+  bool PromptForColor(IColor* pColor, char* prompt) { return false; }
+  bool OpenURL(const char* url, const char* msgWindowTitle, const char* confirmMsg, const char* errMsgOnFailure) { return false; }
+  void* OpenWindow(void* pParentWnd) { return 0; }
+  void CloseWindow() {}
+  void* GetWindow() { return 0; }
+  bool GetTextFromClipboard(WDL_String* pStr) { return false; }
+  void UpdateTooltips() {}
+
+protected:
+  LICE_IBitmap* OSLoadBitmap(int ID, const char* name) { return new LICE_MemBitmap(kFrameSize, kFrameSize * kFrames); }
+
+public:
+  enum { kFrameSize = 48, kFrames = 128 };
+};
+
+// A knob strip at 2x: 96 x 12288 pixels, 4.5 MB, so 7 of them fit the default budget and 8 don't.
+static const int kScaledBytes = (2 * TestGraphics::kFrameSize) * (2 * TestGraphics::kFrameSize * TestGraphics::kFrames) * sizeof(LICE_pixel);
+static const int kFirstID = 100;
+static const int kStrips = 8;
+
+static int sErrors = 0;
+
+static void Check(bool ok, const char* what)
+{
+  printf("%-64s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) ++sErrors;
+}
+
+static IBitmap LoadKnob(IGraphics* pGraphics, int ID, double scale = 2.0)
+{
+  return pGraphics->LoadScaledIBitmap(ID, "knob.png", TestGraphics::kFrames, scale);
+}
+
+int main()
+{
+  // sharing between editors
+  TestGraphics* pA = new TestGraphics;
+  TestGraphics* pB = new TestGraphics;
+  IBitmap a = LoadKnob(pA, kFirstID), b = LoadKnob(pB, kFirstID);
+  Check(a.mData == b.mData && a.W == 2 * TestGraphics::kFrameSize && a.N == TestGraphics::kFrames,
+        "both editors get the same 2x strip");
+  Check(IGraphics::GetScaledBitmapBytes() == kScaledBytes, "the strip is scaled and stored once");
+  IBitmap unscaled = LoadKnob(pA, kFirstID, 1.0);
+  Check(unscaled.mData == pA->LoadIBitmap(kFirstID, "knob.png", TestGraphics::kFrames).mData &&
+        IGraphics::GetScaledBitmapBytes() == kScaledBytes, "1x returns the loaded bitmap, nothing cached");
+
+  // eviction under the default budget
+  for (int i = 1; i < kStrips; ++i) LoadKnob(pA, kFirstID + i);
+  Check(IGraphics::GetScaledBitmapBytes() == kStrips * kScaledBytes, "strips in use are kept beyond the budget");
+  delete pB;
+  Check(IGraphics::GetScaledBitmapBytes() == kStrips * kScaledBytes, "strips still used by the other editor are kept");
+  delete pA; // releases the strips in load order, so the first one is the least recently used
+  Check(IGraphics::GetScaledBitmapBytes() == (kStrips - 1) * kScaledBytes &&
+        IGraphics::GetScaledBitmapBytes() <= DEFAULT_SCALED_BITMAP_BUDGET,
+        "unused strips are trimmed to the budget");
+
+  // with an unlimited budget a cache hit doesn't add bytes and a miss does
+  IGraphics::SetScaledBitmapBudget(INT_MAX);
+  TestGraphics* pC = new TestGraphics;
+  for (int i = 1; i < kStrips; ++i) LoadKnob(pC, kFirstID + i);
+  Check(IGraphics::GetScaledBitmapBytes() == (kStrips - 1) * kScaledBytes, "recently used strips are reused by the next editor");
+  LoadKnob(pC, kFirstID);
+  Check(IGraphics::GetScaledBitmapBytes() == kStrips * kScaledBytes, "the least recently used strip was the one dropped");
+  IGraphics::SetScaledBitmapBudget(DEFAULT_SCALED_BITMAP_BUDGET);
+  Check(IGraphics::GetScaledBitmapBytes() == kStrips * kScaledBytes, "lowering the budget keeps strips in use");
+
+  // releasing a source
+  IBitmap source = pC->LoadIBitmap(kFirstID + 1, "knob.png", TestGraphics::kFrames);
+  pC->ReleaseBitmap(&source);
+  Check(IGraphics::GetScaledBitmapBytes() == kStrips * kScaledBytes, "a strip in use outlives its source");
+  LoadKnob(pC, kFirstID + 1); // reloads the source, possibly at the address of the released one
+  Check(IGraphics::GetScaledBitmapBytes() == (kStrips + 1) * kScaledBytes, "a reloaded source is scaled again");
+  delete pC;
+  Check(IGraphics::GetScaledBitmapBytes() == (kStrips - 1) * kScaledBytes,
+        "the orphaned strip goes first, then the least recently used");
+
+  TestGraphics* pD = new TestGraphics;
+  IBitmap unused = pD->LoadIBitmap(kFirstID + 3, "knob.png", TestGraphics::kFrames);
+  pD->ReleaseBitmap(&unused);
+  Check(IGraphics::GetScaledBitmapBytes() == (kStrips - 2) * kScaledBytes, "an unused strip goes with its source");
+  delete pD;
+
+  if (sErrors)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -190,4 +190,68 @@ static void WDL_DENORMAL_INLINE GetFloatMaxAbsValue(double *out, const double *i
 }
 #endif
 
+#ifdef __cplusplus
+
+////////////////////
+// WDL_DenormalFlushScope: while in scope, the FPU of the calling thread flushes denormal results to zero
+// (FTZ) and treats denormal operands as zero (DAZ), restoring the previous mode on destruction. Put one
+// around real-time processing, e.g. IPlugBase::ProcessBuffers(), so that recursive state decaying
+// toward zero in silence doesn't fall into the (very slow) denormal range. The control register is
+// per-thread and the host may run other plug-ins on the same thread, hence the restore.
+// Only SSE (x86/x64) and AArch64 are supported; elsewhere it is a no-op, and code should still
+// flush its state explicitly (see denormal_fix_float() etc.).
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+
+#include <xmmintrin.h>
+
+#define WDL_DENORMAL_HAVE_FLUSH_SCOPE
+
+class WDL_DenormalFlushScope
+{
+public:
+  WDL_DenormalFlushScope() : m_csr(_mm_getcsr()) { _mm_setcsr(m_csr | 0x8040); } // FTZ (bit 15) | DAZ (bit 6)
+  ~WDL_DenormalFlushScope() { _mm_setcsr(m_csr); }
+
+private:
+  WDL_DenormalFlushScope(const WDL_DenormalFlushScope&);
+  WDL_DenormalFlushScope& operator=(const WDL_DenormalFlushScope&);
+
+  unsigned int m_csr;
+};
+
+#elif defined(__aarch64__) && defined(__GNUC__)
+
+#define WDL_DENORMAL_HAVE_FLUSH_SCOPE
+
+class WDL_DenormalFlushScope
+{
+public:
+  WDL_DenormalFlushScope()
+  {
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(m_fpcr));
+    unsigned long fz = m_fpcr | (1UL << 24); // FZ, covers both operands and results
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fz));
+  }
+  ~WDL_DenormalFlushScope() { __asm__ __volatile__("msr fpcr, %0" : : "r"(m_fpcr)); }
+
+private:
+  WDL_DenormalFlushScope(const WDL_DenormalFlushScope&);
+  WDL_DenormalFlushScope& operator=(const WDL_DenormalFlushScope&);
+
+  unsigned long m_fpcr;
+};
+
+#else
+
+class WDL_DenormalFlushScope
+{
+public:
+  WDL_DenormalFlushScope() {}
+};
+
+#endif
+
+#endif // __cplusplus
+
 #endif
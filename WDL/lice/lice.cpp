@@ -14,6 +14,7 @@
 #include <stdio.h> // only included in case we need to debug with sprintf etc
 
 #include "lice_combine.h"
+#include "lice_combine_simd.h"
 #include "lice_extended.h"
 
 #ifndef _WIN32
@@ -980,7 +981,17 @@ void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const
   // special fast case for copy with no source alpha and alpha=1.0 or 0.5
   else if ((mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))==LICE_BLIT_MODE_COPY && (alpha==1.0||alpha==0.5))
   {
-    if (alpha==0.5)
+    LICE_COMBINEROWFUNC rowfunc;
+    if (alpha==0.5 && src != dest && (rowfunc=LICE_GetHalfMixRowFunc()))
+    {
+      while (i-->0)
+      {
+        rowfunc((LICE_pixel *)pdest,(const LICE_pixel *)psrc,cpsize,128);
+        pdest+=dest_span;
+        psrc += src_span;
+      }
+    }
+    else if (alpha==0.5)
     {
       while (i-->0)
       {
@@ -1010,6 +1021,18 @@ void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const
   else 
   {
     int ia=(int)(alpha*256.0);
+    LICE_COMBINEROWFUNC rowfunc;
+    if (src != dest && (rowfunc=LICE_GetCombineRowFunc(mode,ia)))
+    {
+      while (i-->0)
+      {
+        rowfunc((LICE_pixel *)pdest,(const LICE_pixel *)psrc,cpsize,ia);
+        pdest+=dest_span;
+        psrc += src_span;
+      }
+      return;
+    }
+
     #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
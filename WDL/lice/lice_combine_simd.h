@@ -0,0 +1,432 @@
+#ifndef _LICE_COMBINE_SIMD_H_
+#define _LICE_COMBINE_SIMD_H_
+
+/*
+  SSE2/AVX2 row kernels for the combine modes LICE_Blit() spends most time in
+  (IGraphics draws every bitmap with one of them):
+
+    copy with constant alpha        _LICE_CombinePixelsCopyNoClamp
+    copy with source alpha          _LICE_CombinePixelsCopySourceAlphaNoClamp,
+                                    _LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp (alpha=1.0)
+    add (with or without src alpha) _LICE_CombinePixelsAdd, _LICE_CombinePixelsAddSourceAlpha
+    half mix (copy at alpha=0.5)    _LICE_CombinePixelsHalfMixFAST
+
+  Each kernel processes 4 (SSE2) or 8 (AVX2) pixels at a time and produces
+  exactly the same pixels as the scalar doPix() of the class it replaces,
+  including the truncating integer divisions; leftover pixels at the end of a
+  row go through the scalar class itself. The instruction set is detected once
+  at runtime.
+
+  LICE_GetCombineRowFunc() and LICE_GetHalfMixRowFunc() return NULL when there
+  is no kernel for the mode and alpha (or no SIMD on this CPU/platform), in
+  which case the caller uses the scalar templates as before. Source and
+  destination rows must not overlap.
+
+  Define LICE_NO_SIMD_COMBINE to compile the kernels out.
+*/
+
+#include "lice.h"
+#include "lice_combine.h"
+
+// row combine function: n pixels of src combined onto dest, ia is alpha*256
+typedef void (*LICE_COMBINEROWFUNC)(LICE_pixel *dest, const LICE_pixel *src, int n, int ia);
+
+enum
+{
+  LICE_COMBINE_ISA_SCALAR=0,
+  LICE_COMBINE_ISA_SSE2,
+  LICE_COMBINE_ISA_AVX2,
+};
+
+// scalar reference, used for row tails (and by the tests)
+template<class COMBFUNC> static void _LICE_CombineRowScalar(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  while (n-- > 0)
+  {
+    const LICE_pixel_chan *pin = (const LICE_pixel_chan *)src++;
+    COMBFUNC::doPix((LICE_pixel_chan *)dest++, pin[LICE_PIXEL_R], pin[LICE_PIXEL_G], pin[LICE_PIXEL_B], pin[LICE_PIXEL_A], ia);
+  }
+}
+
+static inline void _LICE_CombineRowHalfMixScalar(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  while (n-- > 0) _LICE_CombinePixelsHalfMixFAST::doPixFAST(dest++, *src++);
+}
+
+#if !defined(LICE_NO_SIMD_COMBINE) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+
+#define LICE_SIMD_COMBINE
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define LICE_SIMD_SSE2 __attribute__((target("sse2")))
+  #define LICE_SIMD_AVX2 __attribute__((target("avx2")))
+#else
+  #define LICE_SIMD_SSE2
+  #define LICE_SIMD_AVX2
+#endif
+
+#define LICE_SIMD_ASHIFT (LICE_PIXEL_A*8)
+
+static inline int _LICE_DetectCombineISA()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  const int maxleaf = info[0];
+  __cpuid(info, 1);
+  const bool sse2 = !!(info[3] & (1<<26));
+  bool avx2 = false;
+  if (maxleaf >= 7 && (info[2] & (1<<27)) && (info[2] & (1<<28)) && (_xgetbv(0) & 6) == 6) // OSXSAVE, AVX, OS saves YMM
+  {
+    __cpuidex(info, 7, 0);
+    avx2 = !!(info[1] & (1<<5));
+  }
+  return avx2 ? LICE_COMBINE_ISA_AVX2 : sse2 ? LICE_COMBINE_ISA_SSE2 : LICE_COMBINE_ISA_SCALAR;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return LICE_COMBINE_ISA_AVX2;
+  return __builtin_cpu_supports("sse2") ? LICE_COMBINE_ISA_SSE2 : LICE_COMBINE_ISA_SCALAR;
+#endif
+}
+
+static inline int LICE_CombineISA()
+{
+  static const int isa = _LICE_DetectCombineISA();
+  return isa;
+}
+
+
+////////////////////
+// SSE2, 4 pixels at a time. Channels are widened to 16 bits, pixels 0,1 in "lo" and 2,3 in "hi".
+
+// s + (d-s)*sc/256 per 16-bit channel, the division truncating toward zero like the scalar code
+static inline LICE_SIMD_SSE2 __m128i _LICE_SSE2_Lerp(__m128i s, __m128i d, __m128i sc)
+{
+  const __m128i diff = _mm_sub_epi16(d, s);
+  const __m128i mlo = _mm_mullo_epi16(diff, sc), mhi = _mm_mulhi_epi16(diff, sc);
+  __m128i p0 = _mm_unpacklo_epi16(mlo, mhi), p1 = _mm_unpackhi_epi16(mlo, mhi);
+  const __m128i bias = _mm_set1_epi32(255);
+  p0 = _mm_srai_epi32(_mm_add_epi32(p0, _mm_and_si128(_mm_srai_epi32(p0, 31), bias)), 8);
+  p1 = _mm_srai_epi32(_mm_add_epi32(p1, _mm_and_si128(_mm_srai_epi32(p1, 31), bias)), 8);
+  return _mm_add_epi16(s, _mm_packs_epi32(p0, p1));
+}
+
+// per-pixel 32-bit values (< 32768) repeated over the 4 channels of each pixel, in 16-bit lanes
+static inline LICE_SIMD_SSE2 void _LICE_SSE2_Spread(__m128i v, __m128i *lo, __m128i *hi)
+{
+  v = _mm_packs_epi32(v, v);
+  v = _mm_unpacklo_epi16(v, v);
+  *lo = _mm_unpacklo_epi32(v, v);
+  *hi = _mm_unpackhi_epi32(v, v);
+}
+
+static inline LICE_SIMD_SSE2 __m128i _LICE_SSE2_Alpha(__m128i px)
+{
+  return _mm_and_si128(_mm_srli_epi32(px, LICE_SIMD_ASHIFT), _mm_set1_epi32(0xff));
+}
+
+static LICE_SIMD_SSE2 void _LICE_SSE2_Copy(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128(), sc = _mm_set1_epi16((short)(256-ia));
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    const __m128i lo = _LICE_SSE2_Lerp(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), sc);
+    const __m128i hi = _LICE_SSE2_Lerp(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), sc);
+    _mm_storeu_si128((__m128i *)(dest+i), _mm_packus_epi16(lo, hi));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopyNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+// ia < 256: sc2 = ia*(a+1)/256, color = lerp by 256-sc2, alpha = min(255, sc2 + dest alpha).
+// a == 0 gives sc2 = 0, which leaves the pixel as is, so no special case is needed.
+static LICE_SIMD_SSE2 void _LICE_SSE2_CopySrcAlpha(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1), c256 = _mm_set1_epi32(256), c255 = _mm_set1_epi32(255);
+  const __m128i via = _mm_set1_epi32(ia), amask = _mm_set1_epi32(0xff << LICE_SIMD_ASHIFT);
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    const __m128i sc2 = _mm_srli_epi32(_mm_mullo_epi16(_mm_add_epi32(_LICE_SSE2_Alpha(s), one), via), 8);
+    __m128i sclo, schi;
+    _LICE_SSE2_Spread(_mm_sub_epi32(c256, sc2), &sclo, &schi);
+    const __m128i lo = _LICE_SSE2_Lerp(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), sclo);
+    const __m128i hi = _LICE_SSE2_Lerp(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), schi);
+    const __m128i a = _mm_min_epi16(_mm_add_epi32(sc2, _LICE_SSE2_Alpha(d)), c255);
+    const __m128i out = _mm_or_si128(_mm_andnot_si128(amask, _mm_packus_epi16(lo, hi)), _mm_slli_epi32(a, LICE_SIMD_ASHIFT));
+    _mm_storeu_si128((__m128i *)(dest+i), out);
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopySourceAlphaNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+// ia == 256: color = lerp by 255-a, alpha = min(255, a + dest alpha), pixels with a == 0 are skipped
+static LICE_SIMD_SSE2 void _LICE_SSE2_CopySrcAlphaFull(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128(), c255 = _mm_set1_epi32(255);
+  const __m128i amask = _mm_set1_epi32(0xff << LICE_SIMD_ASHIFT);
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    const __m128i sa = _LICE_SSE2_Alpha(s);
+    __m128i sclo, schi;
+    _LICE_SSE2_Spread(_mm_sub_epi32(c255, sa), &sclo, &schi);
+    const __m128i lo = _LICE_SSE2_Lerp(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), sclo);
+    const __m128i hi = _LICE_SSE2_Lerp(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), schi);
+    const __m128i a = _mm_min_epi16(_mm_add_epi32(sa, _LICE_SSE2_Alpha(d)), c255);
+    const __m128i out = _mm_or_si128(_mm_andnot_si128(amask, _mm_packus_epi16(lo, hi)), _mm_slli_epi32(a, LICE_SIMD_ASHIFT));
+    const __m128i keep = _mm_cmpeq_epi32(sa, zero);
+    _mm_storeu_si128((__m128i *)(dest+i), _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+#ifndef LICE_DISABLE_BLEND_ADD
+
+// dest + src*ia/256, saturated; src*ia <= 255*256 fits unsigned 16 bits
+static LICE_SIMD_SSE2 void _LICE_SSE2_Add(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128(), sc = _mm_set1_epi16((short)ia);
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), sc), 8);
+    const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), sc), 8);
+    _mm_storeu_si128((__m128i *)(dest+i), _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsAdd>(dest+i, src+i, n-i, ia);
+}
+
+// as _LICE_SSE2_Add with per-pixel alpha ia*(a+1)/256 (a+1 when ia == 256); a == 0 adds nothing
+static LICE_SIMD_SSE2 void _LICE_SSE2_AddSrcAlpha(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1), via = _mm_set1_epi32(ia);
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    __m128i al = _mm_add_epi32(_LICE_SSE2_Alpha(s), one);
+    if (ia < 256) al = _mm_srli_epi32(_mm_mullo_epi16(al, via), 8);
+    __m128i sclo, schi;
+    _LICE_SSE2_Spread(al, &sclo, &schi);
+    const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), sclo), 8);
+    const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), schi), 8);
+    _mm_storeu_si128((__m128i *)(dest+i), _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsAddSourceAlpha>(dest+i, src+i, n-i, ia);
+}
+
+#endif // LICE_DISABLE_BLEND_ADD
+
+static LICE_SIMD_SSE2 void _LICE_SSE2_HalfMix(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m128i mask = _mm_set1_epi32(0x7f7f7f7f);
+  int i = 0;
+  for (; i+4 <= n; i += 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)(src+i)), d = _mm_loadu_si128((const __m128i *)(dest+i));
+    _mm_storeu_si128((__m128i *)(dest+i), _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(d, 1), mask), _mm_and_si128(_mm_srli_epi32(s, 1), mask)));
+  }
+  _LICE_CombineRowHalfMixScalar(dest+i, src+i, n-i, ia);
+}
+
+
+////////////////////
+// AVX2, 8 pixels at a time; the same operations as SSE2 in both 128-bit lanes (unpack/pack work per lane,
+// so the pixel order is preserved).
+
+static inline LICE_SIMD_AVX2 __m256i _LICE_AVX2_Lerp(__m256i s, __m256i d, __m256i sc)
+{
+  const __m256i diff = _mm256_sub_epi16(d, s);
+  const __m256i mlo = _mm256_mullo_epi16(diff, sc), mhi = _mm256_mulhi_epi16(diff, sc);
+  __m256i p0 = _mm256_unpacklo_epi16(mlo, mhi), p1 = _mm256_unpackhi_epi16(mlo, mhi);
+  const __m256i bias = _mm256_set1_epi32(255);
+  p0 = _mm256_srai_epi32(_mm256_add_epi32(p0, _mm256_and_si256(_mm256_srai_epi32(p0, 31), bias)), 8);
+  p1 = _mm256_srai_epi32(_mm256_add_epi32(p1, _mm256_and_si256(_mm256_srai_epi32(p1, 31), bias)), 8);
+  return _mm256_add_epi16(s, _mm256_packs_epi32(p0, p1));
+}
+
+static inline LICE_SIMD_AVX2 void _LICE_AVX2_Spread(__m256i v, __m256i *lo, __m256i *hi)
+{
+  v = _mm256_packs_epi32(v, v);
+  v = _mm256_unpacklo_epi16(v, v);
+  *lo = _mm256_unpacklo_epi32(v, v);
+  *hi = _mm256_unpackhi_epi32(v, v);
+}
+
+static inline LICE_SIMD_AVX2 __m256i _LICE_AVX2_Alpha(__m256i px)
+{
+  return _mm256_and_si256(_mm256_srli_epi32(px, LICE_SIMD_ASHIFT), _mm256_set1_epi32(0xff));
+}
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_Copy(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i zero = _mm256_setzero_si256(), sc = _mm256_set1_epi16((short)(256-ia));
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    const __m256i lo = _LICE_AVX2_Lerp(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), sc);
+    const __m256i hi = _LICE_AVX2_Lerp(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), sc);
+    _mm256_storeu_si256((__m256i *)(dest+i), _mm256_packus_epi16(lo, hi));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopyNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_CopySrcAlpha(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1), c256 = _mm256_set1_epi32(256), c255 = _mm256_set1_epi32(255);
+  const __m256i via = _mm256_set1_epi32(ia), amask = _mm256_set1_epi32(0xff << LICE_SIMD_ASHIFT);
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    const __m256i sc2 = _mm256_srli_epi32(_mm256_mullo_epi16(_mm256_add_epi32(_LICE_AVX2_Alpha(s), one), via), 8);
+    __m256i sclo, schi;
+    _LICE_AVX2_Spread(_mm256_sub_epi32(c256, sc2), &sclo, &schi);
+    const __m256i lo = _LICE_AVX2_Lerp(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), sclo);
+    const __m256i hi = _LICE_AVX2_Lerp(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), schi);
+    const __m256i a = _mm256_min_epi16(_mm256_add_epi32(sc2, _LICE_AVX2_Alpha(d)), c255);
+    const __m256i out = _mm256_or_si256(_mm256_andnot_si256(amask, _mm256_packus_epi16(lo, hi)), _mm256_slli_epi32(a, LICE_SIMD_ASHIFT));
+    _mm256_storeu_si256((__m256i *)(dest+i), out);
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopySourceAlphaNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_CopySrcAlphaFull(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i zero = _mm256_setzero_si256(), c255 = _mm256_set1_epi32(255);
+  const __m256i amask = _mm256_set1_epi32(0xff << LICE_SIMD_ASHIFT);
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    const __m256i sa = _LICE_AVX2_Alpha(s);
+    __m256i sclo, schi;
+    _LICE_AVX2_Spread(_mm256_sub_epi32(c255, sa), &sclo, &schi);
+    const __m256i lo = _LICE_AVX2_Lerp(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), sclo);
+    const __m256i hi = _LICE_AVX2_Lerp(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), schi);
+    const __m256i a = _mm256_min_epi16(_mm256_add_epi32(sa, _LICE_AVX2_Alpha(d)), c255);
+    const __m256i out = _mm256_or_si256(_mm256_andnot_si256(amask, _mm256_packus_epi16(lo, hi)), _mm256_slli_epi32(a, LICE_SIMD_ASHIFT));
+    _mm256_storeu_si256((__m256i *)(dest+i), _mm256_blendv_epi8(out, d, _mm256_cmpeq_epi32(sa, zero)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp>(dest+i, src+i, n-i, ia);
+}
+
+#ifndef LICE_DISABLE_BLEND_ADD
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_Add(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i zero = _mm256_setzero_si256(), sc = _mm256_set1_epi16((short)ia);
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    const __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), sc), 8);
+    const __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), sc), 8);
+    _mm256_storeu_si256((__m256i *)(dest+i), _mm256_adds_epu8(d, _mm256_packus_epi16(lo, hi)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsAdd>(dest+i, src+i, n-i, ia);
+}
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_AddSrcAlpha(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1), via = _mm256_set1_epi32(ia);
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    __m256i al = _mm256_add_epi32(_LICE_AVX2_Alpha(s), one);
+    if (ia < 256) al = _mm256_srli_epi32(_mm256_mullo_epi16(al, via), 8);
+    __m256i sclo, schi;
+    _LICE_AVX2_Spread(al, &sclo, &schi);
+    const __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), sclo), 8);
+    const __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), schi), 8);
+    _mm256_storeu_si256((__m256i *)(dest+i), _mm256_adds_epu8(d, _mm256_packus_epi16(lo, hi)));
+  }
+  _LICE_CombineRowScalar<_LICE_CombinePixelsAddSourceAlpha>(dest+i, src+i, n-i, ia);
+}
+
+#endif // LICE_DISABLE_BLEND_ADD
+
+static LICE_SIMD_AVX2 void _LICE_AVX2_HalfMix(LICE_pixel *dest, const LICE_pixel *src, int n, int ia)
+{
+  const __m256i mask = _mm256_set1_epi32(0x7f7f7f7f);
+  int i = 0;
+  for (; i+8 <= n; i += 8)
+  {
+    const __m256i s = _mm256_loadu_si256((const __m256i *)(src+i)), d = _mm256_loadu_si256((const __m256i *)(dest+i));
+    _mm256_storeu_si256((__m256i *)(dest+i), _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(d, 1), mask), _mm256_and_si256(_mm256_srli_epi32(s, 1), mask)));
+  }
+  _LICE_CombineRowHalfMixScalar(dest+i, src+i, n-i, ia);
+}
+
+#endif // LICE_SIMD_COMBINE
+
+
+// Kernel for blit mode (LICE_BLIT_MODE_* | LICE_BLIT_USE_ALPHA, filter bits ignored) and ia = alpha*256,
+// for the given instruction set (LICE_CombineISA() for the best one), or NULL.
+static inline LICE_COMBINEROWFUNC LICE_GetCombineRowFunc(int mode, int ia, int isa)
+{
+#ifdef LICE_SIMD_COMBINE
+  if (ia < 1 || ia > 256 || isa == LICE_COMBINE_ISA_SCALAR) return NULL;
+  const bool avx2 = isa >= LICE_COMBINE_ISA_AVX2;
+  switch (mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))
+  {
+    case LICE_BLIT_MODE_COPY:
+      if (ia == 256) return NULL; // plain copy, memmove does it
+      return avx2 ? _LICE_AVX2_Copy : _LICE_SSE2_Copy;
+    case LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA:
+      if (ia == 256) return avx2 ? _LICE_AVX2_CopySrcAlphaFull : _LICE_SSE2_CopySrcAlphaFull;
+      return avx2 ? _LICE_AVX2_CopySrcAlpha : _LICE_SSE2_CopySrcAlpha;
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD:
+      return avx2 ? _LICE_AVX2_Add : _LICE_SSE2_Add;
+    case LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA:
+      return avx2 ? _LICE_AVX2_AddSrcAlpha : _LICE_SSE2_AddSrcAlpha;
+#endif
+  }
+#endif
+  return NULL;
+}
+
+static inline LICE_COMBINEROWFUNC LICE_GetCombineRowFunc(int mode, int ia)
+{
+#ifdef LICE_SIMD_COMBINE
+  return LICE_GetCombineRowFunc(mode, ia, LICE_CombineISA());
+#else
+  return NULL;
+#endif
+}
+
+// Kernel for the half mix of LICE_Blit's copy at alpha=0.5 (_LICE_CombinePixelsHalfMixFAST, which rounds
+// differently from _LICE_CombinePixelsCopyNoClamp at ia=128), or NULL. ia is ignored.
+static inline LICE_COMBINEROWFUNC LICE_GetHalfMixRowFunc(int isa)
+{
+#ifdef LICE_SIMD_COMBINE
+  if (isa == LICE_COMBINE_ISA_SCALAR) return NULL;
+  return isa >= LICE_COMBINE_ISA_AVX2 ? _LICE_AVX2_HalfMix : _LICE_SSE2_HalfMix;
+#else
+  return NULL;
+#endif
+}
+
+static inline LICE_COMBINEROWFUNC LICE_GetHalfMixRowFunc()
+{
+#ifdef LICE_SIMD_COMBINE
+  return LICE_GetHalfMixRowFunc(LICE_CombineISA());
+#else
+  return NULL;
+#endif
+}
+
+#endif // _LICE_COMBINE_SIMD_H_